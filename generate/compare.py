@@ -0,0 +1,61 @@
+# compares the compile time of a source file when it includes
+#    - the monolithic header.hpp
+#    - the umbrella header (which includes all per-peripheral headers)
+#    - only the per-peripheral headers it actually uses
+#
+# run it in the directory where generate.py wrote its headers
+#
+# python compare.py [ source [ peripheral ... ] ]
+
+import os, subprocess, sys, time
+
+compiler = os.environ.get( "CXX", "g++" )
+flags = [ "-std=c++20", "-Wno-volatile", "-fsyntax-only", "-I../test/native/test" ]
+runs = 5
+
+source = "../test/native/test/main.cpp"
+peripherals = [ "pmc", "supc", "efc0", "efc1" ]
+umbrella = "sam3x8e.hpp"
+if len( sys.argv ) > 1:
+   source = sys.argv[ 1 ]
+if len( sys.argv ) > 2:
+   peripherals = sys.argv[ 2 : ]
+
+def variant( name, includes ):
+   text = open( source ).read()
+   text = text.replace(
+      "#include \"header.hpp\"",
+      "".join( "#include \"%s\"\n" % include for include in includes ) )
+   file_name = "_compare_%s.cpp" % name
+   open( file_name, "w" ).write( text )
+   return file_name
+
+def compile_time( file_name ):
+   best = None
+   for n in range( runs ):
+      start = time.perf_counter()
+      result = subprocess.run(
+         [ compiler ] + flags + [ file_name ],
+         stdout = subprocess.DEVNULL, stderr = subprocess.DEVNULL )
+      elapsed = time.perf_counter() - start
+      if best == None or elapsed < best:
+         best = elapsed
+   return best, result.returncode
+
+variants = [
+   ( "monolithic", [ "header.hpp" ] ),
+   ( "umbrella",   [ umbrella ] ),
+   ( "split",      [ "%s.hpp" % p for p in peripherals ] ),
+]
+
+print( "%s, best of %d runs of %s" % ( source, runs, " ".join( [ compiler ] + flags ) ) )
+reference = None
+for name, includes in variants:
+   file_name = variant( name, includes )
+   elapsed, status = compile_time( file_name )
+   os.remove( file_name )
+   if reference == None:
+      reference = elapsed
+   print( "   %-12s %6.3f s  %5.1f%%%s" % (
+      name, elapsed, 100.0 * elapsed / reference,
+      "" if status == 0 else "  (compiler reported errors)" ) )
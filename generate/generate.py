@@ -1,11 +1,11 @@
 # https://github.com/posborne/cmsis-svd
 
 # read access : register & field -> value
-# read-only, write-only tags in svd
 # registers that are 32 bits wide : direct value access
 # peripherals that are 1 register: no struct?
 # separate individual registers?
 
+import re
 from cmsis_svd.parser import SVDParser
 
 separator = "// %s\n" % ( 77 * "=" )
@@ -17,39 +17,255 @@ def peripheral_prefix( peripheral ):
    else:
       return ""   
 
-def field_value( peripheral, register, field, value ):
+# When layout is not None the field constants are aliases, with the
+# name prefix of peripheral, of the field constants of layout.
+def field_value( peripheral, register, field, value, layout = None ):
    name = "%s%s_%s_%s" % ( peripheral_prefix( peripheral ), register.name.upper(), field.name.upper(), value.name.upper() )
    name = name.replace( "[0]", "" )
    s = ""
    if not ( "[" in name ):
       s += "      // %s\n" % value.description
-      s += "      constexpr auto %s = %s::field_value_literal< 0x%08x, %d, %d >( %d );\n" % ( 
-         name, prefix, peripheral.base_address + register.address_offset, field.bit_offset, field.bit_width, value.value ) 
+      if layout != None:
+         s += "      constexpr auto %s = %s;\n" % ( 
+            name, name.replace( peripheral_prefix( peripheral ), peripheral_prefix( layout ), 1 ) )
+      else:
+         s += "      constexpr auto %s = %s::field_value_literal< 0x%08x, %d, %d >( %d );\n" % ( 
+            name, prefix, peripheral.base_address + register.address_offset, field.bit_offset, field.bit_width, value.value ) 
    return s
 
-def register_field( peripheral, register, field ):
+def register_field( peripheral, register, field, layout = None ):
    name = "%s%s_%s" % ( peripheral_prefix( peripheral ), register.name.upper(), field.name.upper() )
    name = name.replace( "[0]", "" )
    mask = "_Msk" if field.bit_width > 1 else ""
    s = ""
    if not ( "[" in name ):
       s += "   // %s\n" % field.description
-      s += "   constexpr auto %s%s = %s::field_mask_literal< 0x%08x, %d, %d >();\n" % ( 
-         name, mask, prefix, peripheral.base_address + register.address_offset, field.bit_offset, field.bit_width )    
+      if layout != None:
+         s += "   constexpr auto %s%s = %s%s;\n" % ( 
+            name, mask, name.replace( peripheral_prefix( peripheral ), peripheral_prefix( layout ), 1 ), mask )
+      else:
+         s += "   constexpr auto %s%s = %s::field_mask_literal< 0x%08x, %d, %d >();\n" % ( 
+            name, mask, prefix, peripheral.base_address + register.address_offset, field.bit_offset, field.bit_width )    
       if field.enumerated_values != None : 
          for value in field.enumerated_values:
-            s += field_value( peripheral, register, field, value )   
+            s += field_value( peripheral, register, field, value, layout )   
+   return s
+
+# runs of at least this many numbered fields are collapsed
+minimum_run_length = 4
+
+# returns ( stem, number ) for a field named like P17, otherwise None
+def numbered_field( field ):
+   match = re.fullmatch( r"([A-Za-z_]\w*?)(\d+)", field.name )
+   if match == None or field.enumerated_values != None:
+      return None
+   return match.group( 1 ), int( match.group( 2 ) )
+
+# finds the runs of numbered fields (like P0 .. P31) that have the
+# same width, consecutive numbers and equidistant bit offsets,
+# returns a list of those runs, each a list of fields
+def numbered_field_runs( register ):
+   groups = {}
+   for field in register.fields:
+      numbered = numbered_field( field )
+      if numbered != None:
+         groups.setdefault( ( numbered[ 0 ], field.bit_width ), [] ).append( field )
+   runs = []
+   for fields in groups.values():
+      fields = sorted( fields, key = lambda f : numbered_field( f )[ 1 ] )
+      first, last = numbered_field( fields[ 0 ] )[ 1 ], numbered_field( fields[ -1 ] )[ 1 ]
+      if len( fields ) < max( 2, minimum_run_length ) or last - first + 1 != len( fields ):
+         continue
+      stride = fields[ 1 ].bit_offset - fields[ 0 ].bit_offset
+      if stride < fields[ 0 ].bit_width:
+         continue
+      if all( f.bit_offset == fields[ 0 ].bit_offset + i * stride 
+              for i, f in enumerate( fields ) ):
+         runs.append( fields )
+   return runs
+
+# a run of numbered fields as one indexed field: NAME< n >
+def register_field_run( peripheral, register, fields, layout = None ):
+   stem, first = numbered_field( fields[ 0 ] )
+   last = first + len( fields ) - 1
+   name = "%s%s_%s" % ( peripheral_prefix( peripheral ), register.name.upper(), stem.upper() )
+   mask = "_Msk" if fields[ 0 ].bit_width > 1 else ""
+   stride = fields[ 1 ].bit_offset - fields[ 0 ].bit_offset
+   index = "n" if first == 0 else "( n - %d )" % first
+   offset = index if stride == 1 else "%s * %d" % ( index, stride )
+   if fields[ 0 ].bit_offset != 0:
+      offset = "%d + %s" % ( fields[ 0 ].bit_offset, offset )
+   s = ""
+   if not ( "[" in name ):
+      s += "   // %s (%s%d .. %s%d)\n" % ( fields[ 0 ].description, stem, first, stem, last )
+      s += "   template< int n > requires( n >= %d && n <= %d )\n" % ( first, last )
+      if layout != None:
+         s += "   constexpr auto %s%s = %s%s< n >;\n" % ( 
+            name, mask, name.replace( peripheral_prefix( peripheral ), peripheral_prefix( layout ), 1 ), mask )
+      else:
+         s += "   constexpr auto %s%s = %s::field_mask_literal< 0x%08x, %s, %d >();\n" % ( 
+            name, mask, prefix, peripheral.base_address + register.address_offset, offset, fields[ 0 ].bit_width )    
    return s
 
-def register_fields( peripheral, register ):
+def register_fields( peripheral, register, layout = None ):
+   runs = numbered_field_runs( register )
+   collapsed = { id( field ) : run for run in runs for field in run }
    s = ""
    for field in register.fields:
-      s += register_field( peripheral, register, field )
+      if not id( field ) in collapsed:
+         s += register_field( peripheral, register, field, layout )
+      elif collapsed[ id( field ) ][ 0 ] is field:
+         s += register_field_run( peripheral, register, collapsed[ id( field ) ], layout )
    return s
 
-def register_type( peripheral, register ):
-   address = peripheral.base_address + register.address_offset
-   return "%s::hardware_register<0x%08x>" % ( prefix, address )
+# the field constants are generated for the first of a numbered
+# set of peripherals only
+def has_field_constants( peripheral ):
+   return not peripheral.name[ -1: ] in [ "1", "2", "3", "4", "5", "6", "7", "8", "9" ]
+
+# a peripheral that shares the field constants of shared_with, but has
+# its own name prefix, gets those constants under its own names
+def field_aliases( peripheral, shared_with ):
+   if peripheral_prefix( peripheral ) in [ "", peripheral_prefix( shared_with ) ] \
+         or not has_field_constants( shared_with ):
+      return ""
+   s = ""
+   for register in sorted( shared_with.registers, key = lambda r : r.address_offset ):
+      v = register_fields( peripheral, register, shared_with )
+      if v != "":
+         s += "// %s\n" % register.name.upper()
+         s += v
+         s += "\n"
+   return s
+
+# SVD access -> hr::register_access
+svd_access = {
+   "read-write"     : "read_write",
+   "read-only"      : "read_only",
+   "write-only"     : "write_only",
+   "writeOnce"      : "write_only",
+   "read-writeOnce" : "read_write",
+}
+
+# the SVD value of a register or field attribute, or None
+def svd_attribute( element, name ):
+   value = getattr( element, name, None )
+   return getattr( value, "value", value )
+
+# SVD modifiedWriteValues -> hr::modified_write,
+# the others (clear, set, modify) are plain writes
+svd_modified_write = {
+   "oneToClear"   : "one_to_clear",
+   "oneToSet"     : "one_to_set",
+   "oneToToggle"  : "one_to_toggle",
+   "zeroToClear"  : "zero_to_clear",
+   "zeroToSet"    : "zero_to_set",
+   "zeroToToggle" : "zero_to_toggle",
+}
+
+# SVD readAction -> hr::read_action
+svd_read_action = {
+   "clear"          : "clear",
+   "set"            : "set",
+   "modify"         : "modify",
+   "modifyExternal" : "modify_external",
+}
+
+# the value of a register attribute: when the register has none, 
+# the value of its fields when they all agree, otherwise None
+def register_attribute( register, name ):
+   value = svd_attribute( register, name )
+   if value == None:
+      values = set( svd_attribute( field, name ) for field in register.fields )
+      if len( values ) == 1:
+         value = values.pop()
+   return value
+
+def register_access( register ):
+   return svd_access.get( 
+      register_attribute( register, "access" ), "read_write" )
+
+def register_modified_write( register ):
+   return svd_modified_write.get( 
+      register_attribute( register, "modified_write_values" ), "modify" )
+
+# a register has a read action when the register or any of its fields
+# has one: a read of the register reads all its fields
+def register_read_action( register ):
+   actions = [ svd_attribute( register, "read_action" ) ] + [ 
+      svd_attribute( field, "read_action" ) for field in register.fields ]
+   for action in actions:
+      if action in svd_read_action:
+         return svd_read_action[ action ]
+   return "none"
+
+# returns ( reset_value, reset_mask ): 
+# a register without a reset value has an empty reset mask
+def register_reset( register ):
+   value = svd_attribute( register, "reset_value" )
+   mask = svd_attribute( register, "reset_mask" )
+   if value == None:
+      return 0, 0
+   if mask == None:
+      mask = 0xFFFFFFFF
+   return value & mask, mask
+
+# the union of the masks of the fields that can be written,
+# or all bits when the register has no fields
+def register_writable( register ):
+   if len( register.fields ) == 0:
+      return 0xFFFFFFFF
+   register_access = svd_attribute( register, "access" )
+   writable = 0
+   for field in register.fields:
+      access = svd_attribute( field, "access" ) or register_access
+      if svd_access.get( access, "read_write" ) != "read_only":
+         writable |= ( ( 1 << field.bit_width ) - 1 ) << field.bit_offset
+   return writable
+
+# registers that are updated by both the main code and interrupt
+# handlers: { "PERIPHERAL.REGISTER" : hr::register_concurrency },
+# like { "PIOB.PIO_ODSR" : "exclusive", "PMC.PMC_PCR" : "critical_section" }
+register_concurrency = {}
+
+# the hr::register_properties template arguments, in the order of 
+# its parameters, without the trailing ones that have the default value
+def register_properties( register, peripheral = None ):
+   access = register_access( register )
+   writable = register_writable( register )
+   if access == "read_only":
+      writable = 0xFFFFFFFF
+   reset_value, reset_mask = register_reset( register )
+   write = register_modified_write( register )
+   read = register_read_action( register )
+   concurrency = "none"
+   if peripheral != None:
+      concurrency = register_concurrency.get( 
+         "%s.%s" % ( peripheral.name, register.name ), "none" )
+   arguments = [ 
+      ( "%s::register_access::%s" % ( prefix, access ), 
+         access == "read_write" ),
+      ( "0x%08x" % writable, writable == 0xFFFFFFFF ),
+      ( "0x%08x" % reset_value, reset_value == 0 ),
+      ( "0x%08x" % reset_mask, reset_mask == 0 ),
+      ( "%s::modified_write::%s" % ( prefix, write ), write == "modify" ),
+      ( "%s::read_action::%s" % ( prefix, read ), read == "none" ),
+      ( "%s::register_concurrency::%s" % ( prefix, concurrency ), 
+         concurrency == "none" ),
+   ]
+   while arguments != [] and arguments[ -1 ][ 1 ]:
+      arguments.pop()
+   return [ argument for argument, default in arguments ]
+
+# the address is that of the layout peripheral, 
+# the properties are those of the peripheral itself
+def register_type( layout, peripheral, register ):
+   address = layout.base_address + register.address_offset
+   properties = register_properties( register, peripheral )
+   if properties == []:
+      return "%s::hardware_register<0x%08x>" % ( prefix, address )
+   return "%s::hardware_register<0x%08x, %s::register_properties< %s >>" % ( 
+      prefix, address, prefix, ", ".join( properties ) )
 
 def register_definition( peripheral, register ):
    name = "%s_%s" % ( peripheral.name.upper(), register.name.upper() )
@@ -59,7 +275,7 @@ def register_definition( peripheral, register ):
    s += "// %s\n" % register.name
    s += "// %s\n" % register.description
    s += "#define %s ( * ( %s * ) 0x%08x )\n" % ( 
-       name, register_type( peripheral, register ), address )
+       name, register_type( peripheral, peripheral, register ), address )
    return s
 
 def peripheral_definition( peripheral, register ):
@@ -70,29 +286,327 @@ def peripheral_definition( peripheral, register ):
    s += "// %s\n" % register.name
    s += "// %s\n" % register.description
    s += "#define %s ( * ( %s * ) 0x%08x )\n" % ( 
-       name, register_type( peripheral, register ), address )
+       name, register_type( peripheral, peripheral, register ), address )
    return s
    
 def camel( s ):
    return s[ 0 ].upper() + s[ 1 : ].lower()   
 
-def generate_peripheral( peripheral ):
+# the registers of a peripheral: a derived peripheral 
+# without registers has those of shared_with
+def peripheral_registers( peripheral, shared_with = None ):
+   if len( peripheral.registers ) == 0 and shared_with != None:
+      return shared_with.registers
+   return peripheral.registers
+
+# what identifies the layout of a peripheral: two peripherals with
+# the same signature can share the field constants, and when their 
+# register properties are the same too, one struct
+def peripheral_signature( peripheral, properties = False, registers = None ):
+   if registers == None:
+      registers = peripheral.registers
+   return tuple( 
+      ( register.name, register.address_offset, register.alternate_group, 
+        tuple( register_properties( register, peripheral ) if properties else [] ),
+        tuple( ( field.name, field.bit_offset, field.bit_width ) 
+           for field in register.fields ) )
+      for register in sorted( registers, key = lambda r : r.address_offset ) )
+
+# a peripheral that shares the layout of shared_with can also share
+# its struct when its registers have the same properties
+def same_struct( peripheral, shared_with ):
+   return peripheral_signature( peripheral, True,
+         peripheral_registers( peripheral, shared_with ) ) \
+      == peripheral_signature( shared_with, True )
+
+# returns a { name : peripheral } dictionary that maps each peripheral 
+# that is derived from, or structurally identical to, an earlier one
+# to the first of those peripherals
+def shared_peripherals( device ):
+   by_name = {}
+   by_signature = {}
+   shared = {}
+   for peripheral in device.peripherals:
+      if peripheral.derived_from != None and len( peripheral.registers ) == 0:
+         first = by_name[ peripheral.derived_from ]
+         shared[ peripheral.name ] = shared.get( first.name, first )
+      else:
+         signature = peripheral_signature( peripheral )
+         if signature in by_signature:
+            shared[ peripheral.name ] = by_signature[ signature ]
+         else:
+            by_signature[ signature ] = peripheral
+      by_name[ peripheral.name ] = peripheral
+   return shared
+
+# returns the names of the peripherals whose struct is also that of
+# other peripherals ( using PIOB = Pioa )
+def shared_structs( device ):
+   shared = shared_peripherals( device )
+   return set( 
+      shared[ peripheral.name ].name for peripheral in device.peripherals 
+      if peripheral.name in shared 
+         and same_struct( peripheral, shared[ peripheral.name ] ) )
+
+# the peripheral PERIPHERAL at its address, as a #define or 
+# (in a module, where a macro can't be exported) as a constexpr object 
+def peripheral_instance( peripheral, struct_name, module ):
+   if module:
+      return "inline constexpr %s::peripheral< %s, 0x%08x > %s = {};\n\n" % ( 
+          prefix, struct_name, peripheral.base_address, peripheral.name.upper() )
+   else:
+      return "#define %s ( ( %s * ) 0x%08x )\n\n" % ( 
+          peripheral.name.upper(), struct_name, peripheral.base_address )
+
+# ( status, mask, suffix ) register names (without the peripheral 
+# prefix) of an interrupt status register and its interrupt mask (or 
+# enable) register, which have their fields at the same bit positions,
+# and the name suffix of the mask fields that enable an interrupt
+# (the other fields, like DMA request enables, are not interrupts)
+#
+# PWM is dispatched by ISR1 (channel and fault interrupts) only, the
+# comparison and synchronous-channel interrupts of ISR2 are not. 
+# UOTGHS gets no dispatcher: its interrupt combines the general SR, 
+# the device DEVISR and the host HSTISR and their endpoint and pipe 
+# registers, each with its own mask register.
+interrupt_registers = [
+   ( "SR",     "IMR",    "" ),
+   ( "ISR",    "IMR",    "" ),
+   ( "CSR",    "IMR",    "" ),
+   ( "SR",     "DIER",   "IE" ),
+   ( "PR",     "IMR",    "" ),
+   ( "ISR1",   "IMR1",   "" ),
+   ( "EBCISR", "EBCIMR", "" ),
+]
+
+# ( status, mask, suffix ) register names, without the channel number, 
+# of the channels of a peripheral that each have their own status and 
+# mask register (SR0, IMR0, SR1, ...) and their own interrupt, like the
+# TC channels
+channel_interrupt_registers = [
+   ( "SR",     "IMR",    "" ),
+]
+
+def interrupt_registers_by_name( registers ):
+   by_name = {}
+   for register in registers:
+      if register.alternate_group == None and not "[" in register.name:
+         by_name[ register.name.upper().split( "_" )[ -1 ] ] = register
+   return by_name
+
+# returns the ( status, mask, suffix ) of a peripheral, or None
+def peripheral_interrupt_registers( registers ):
+   by_name = interrupt_registers_by_name( registers )
+   for status, mask, suffix in interrupt_registers:
+      if status in by_name and mask in by_name:
+         return by_name[ status ], by_name[ mask ], suffix
+   return None
+
+# returns [ ( status, mask, suffix ) ] of the channels of a peripheral,
+# by channel number, or []
+def channel_interrupt_registers_of( registers ):
+   by_name = interrupt_registers_by_name( registers )
+   for status, mask, suffix in channel_interrupt_registers:
+      channels = []
+      while ( "%s%d" % ( status, len( channels ) ) in by_name
+            and "%s%d" % ( mask, len( channels ) ) in by_name ):
+         channels.append( ( 
+            by_name[ "%s%d" % ( status, len( channels ) ) ], 
+            by_name[ "%s%d" % ( mask, len( channels ) ) ], 
+            suffix ) )
+      if channels != []:
+         return channels
+   return []
+
+# returns [ ( status, mask, suffix ) ] of a peripheral: one, or one 
+# per channel, or [] when it has no interrupt status register
+def interrupt_sources( registers ):
+   found = peripheral_interrupt_registers( registers )
+   if found != None:
+      return [ found ]
+   return channel_interrupt_registers_of( registers )
+
+def interrupt_enum_name( peripheral ):
+   return "%sInterrupt" % camel( peripheral.name )
+
+# returns [ ( bit, name ) ] for the single-bit interrupt fields of 
+# the mask register, named as the status register field at that bit
+def interrupt_fields( status, mask, suffix ):
+   status_names = { 
+      field.bit_offset : field.name.upper() 
+      for field in status.fields if field.bit_width == 1 }
+   return [ 
+      ( field.bit_offset, status_names[ field.bit_offset ] ) 
+      for field in sorted( mask.fields, key = lambda f : f.bit_offset ) 
+      if field.bit_width == 1 and field.bit_offset in status_names 
+         and field.name.upper().endswith( suffix ) ]
+
+# the interrupts of a peripheral: an enum of the status fields
+# (their bit numbers), the keys for the hr::handler of a dispatcher;
+# the channels of a peripheral share the enum of the first channel
+def interrupt_enum( peripheral ):
+   sources = interrupt_sources( peripheral.registers )
+   if sources == []:
+      return ""
+   fields = interrupt_fields( *sources[ 0 ] )
+   if fields == []:
+      return ""
+   s = ""
+   s += "// %s interrupts, by %s field\n" % ( 
+      peripheral.name, sources[ 0 ][ 0 ].name.upper() )
+   s += "enum class %s {\n" % interrupt_enum_name( peripheral )
+   for bit, name in fields:
+      s += "   %s = %d,\n" % ( name, bit )
+   s += "};\n\n"
+   return s
+
+# the dispatcher, called name_dispatch, of the pending interrupts 
+# in the status and mask registers of a peripheral
+def dispatcher( name, peripheral, layout, status, mask ):
+   s = ""
+   s += "template< typename... _handlers >\n"
+   s += "   __attribute__((always_inline))\n"
+   s += "inline void %s_dispatch(){\n" % name.lower()
+   s += "   %s::dispatch< %s, _handlers... >(\n" % ( 
+      prefix, interrupt_enum_name( layout ) )
+   s += "      %s->%s.read().value & %s->%s.read().value );\n" % ( 
+      peripheral.name.upper(), status.name.upper(), 
+      peripheral.name.upper(), mask.name.upper() )
+   s += "}\n\n"
+   return s
+
+# the dispatcher of the pending interrupts of a peripheral that 
+# has an interrupt, with the interrupt enum of layout; a peripheral 
+# with an interrupt per channel has a dispatcher per channel, named 
+# after the interrupt of that channel (TC1 channel 0 is tc3_dispatch)
+def interrupt_dispatcher( peripheral, layout ):
+   interrupts = sorted( 
+      getattr( peripheral, "interrupts", None ) or [], 
+      key = lambda i : i.value )
+   sources = interrupt_sources( layout.registers )
+   if interrupts == [] or sources == [] \
+         or interrupt_fields( *sources[ 0 ] ) == []:
+      return ""
+   s = ""
+   if len( sources ) == 1:
+      status, mask, suffix = sources[ 0 ]
+      s += "// call the handlers of the pending %s interrupts\n" % (
+         peripheral.name )
+      s += dispatcher( peripheral.name, peripheral, layout, status, mask )
+   elif len( sources ) == len( interrupts ):
+      for channel, ( status, mask, suffix ) in enumerate( sources ):
+         s += "// call the handlers of the pending %s channel %d interrupts\n" % (
+            peripheral.name, channel )
+         s += dispatcher( 
+            interrupts[ channel ].name, peripheral, layout, status, mask )
+   return s
+
+# the Cortex-M exceptions that have an IRQ number (CMSIS names)
+cortex_m_exceptions = [
+   ( "NonMaskableInt",   -14 ),
+   ( "HardFault",        -13 ),
+   ( "MemoryManagement", -12 ),
+   ( "BusFault",         -11 ),
+   ( "UsageFault",       -10 ),
+   ( "SVCall",            -5 ),
+   ( "DebugMonitor",      -4 ),
+   ( "PendSV",            -2 ),
+   ( "SysTick",           -1 ),
+]
+
+# the enumerator of an interrupt: the suffix avoids a clash with
+# the peripheral macros, some interrupts have the peripheral name
+def irq_name( name ):
+   return "%s_IRQn" % name
+
+# returns [ ( name, value ) ] of the interrupts of all peripherals,
+# by value (two peripherals can share an interrupt)
+def device_interrupts( device ):
+   interrupts = {}
+   for peripheral in device.peripherals:
+      for interrupt in getattr( peripheral, "interrupts", None ) or []:
+         interrupts[ interrupt.name ] = interrupt.value
+   return sorted( interrupts.items(), key = lambda i : ( i[ 1 ], i[ 0 ] ) )
+
+# the Irq enum and number_of_irqs, for hr::make_vector_table
+def generate_interrupts( device ):
+   interrupts = device_interrupts( device )
+   if interrupts == []:
+      return ""
+   s = ""
+   s += separator
+   s += "//\n"
+   s += "// interrupts: the IRQ numbers, and those of the Cortex-M exceptions\n"
+   s += "//\n"
+   s += separator
+   s += "\n"
+   s += "enum class Irq : int {\n"
+   for name, value in cortex_m_exceptions + interrupts:
+      s += "   %s = %d,\n" % ( irq_name( name ), value )
+   s += "};\n\n"
+   s += "inline constexpr int number_of_irqs = %d;\n\n" % ( interrupts[ -1 ][ 1 ] + 1 )
+   return s
+
+# the set of IRQs of a peripheral, for hr::nvic_enable etc.
+def peripheral_irqs( peripheral ):
+   interrupts = getattr( peripheral, "interrupts", None ) or []
+   if interrupts == []:
+      return ""
+   s = ""
+   s += "// the interrupts of %s\n" % peripheral.name
+   s += "inline constexpr %s::irq_set %s_IRQS = %s::make_irq_set(\n   %s );\n\n" % ( 
+      prefix, peripheral.name.upper(), prefix, 
+      ",\n   ".join( "Irq::%s" % irq_name( interrupt.name ) 
+         for interrupt in sorted( interrupts, key = lambda i : i.value ) ) )
+   return s
+
+# When shared_with is not None the peripheral re-uses the struct of
+# that peripheral, or when the register properties (like the reset 
+# values) differ, only its field constants. The struct and the field 
+# constants use the register addresses of that peripheral, which is 
+# fine because these addresses only identify the register type: the 
+# actual location is determined by the peripheral address.
+def generate_peripheral( 
+   peripheral, shared_with = None, module = False, struct_shared = False 
+):
    s = ""
    s += separator
    s += "//\n"
    s += "// %s\n" % peripheral.name
    s += "// base address = 0x%08x\n" % peripheral.base_address
    s += "// %s\n" % peripheral.description
+   if shared_with != None and same_struct( peripheral, shared_with ):
+      s += "// same registers and fields as %s\n" % shared_with.name
+   elif shared_with != None:
+      s += "// same fields as %s, other register properties\n" % shared_with.name
    s += "//\n"
    s += separator
    
    s += "\n"
+   if shared_with != None and same_struct( peripheral, shared_with ):
+      s += "using %s = %s;\n\n" % ( camel( peripheral.name ), camel( shared_with.name ) )
+      s += peripheral_instance( peripheral, camel( shared_with.name ), module )
+      s += peripheral_irqs( peripheral )
+      s += field_aliases( peripheral, shared_with )
+      s += interrupt_dispatcher( peripheral, shared_with )
+      return s
+      
+   # the peripheral that provides the register addresses
+   layout = peripheral if shared_with == None else shared_with
+      
+   # the base_address only when the struct is that of one peripheral
    s += "struct %s {\n" % camel( peripheral.name )
+   s += "   static constexpr %s::register_address_type layout_address = 0x%08x;\n" % ( 
+      prefix, layout.base_address )
+   if not struct_shared:
+      s += "   static constexpr %s::register_address_type base_address = 0x%08x;\n" % ( 
+         prefix, peripheral.base_address )
    delay = ""
    gather = "@"
    offset = 0
    sorted_peripherals = sorted( 
-      peripheral.registers, key = lambda r : r.address_offset )
+      peripheral_registers( peripheral, shared_with ), 
+      key = lambda r : r.address_offset )
    for register in sorted_peripherals:
 
       # ignore alternate groups (they overlap, could be a union)
@@ -100,7 +614,7 @@ def generate_peripheral( peripheral ):
          continue
          
       v = "   %s %s;\n" % \
-         ( register_type( peripheral, register ), register.name.upper() )
+         ( register_type( layout, peripheral, register ), register.name.upper() )
          
          
       if offset != register.address_offset:
@@ -131,10 +645,16 @@ def generate_peripheral( peripheral ):
    s += delay      
    s += "};\n\n"
    
-   s += "#define %s ( ( %s * ) 0x%08x )\n\n" % ( 
-       peripheral.name.upper(), camel( peripheral.name ), peripheral.base_address )
+   s += peripheral_instance( peripheral, camel( peripheral.name ), module )
+   
+   s += peripheral_irqs( peripheral )
+   
+   if shared_with != None:
+      s += field_aliases( peripheral, shared_with )
+      s += interrupt_dispatcher( peripheral, shared_with )
+      return s
        
-   if not peripheral.name[ -1: ] in [ "1", "2", "3", "4", "5", "6", "7", "8", "9" ]:
+   if has_field_constants( peripheral ):
     for register in sorted_peripherals:
       v = register_fields( peripheral, register )
       if v != "":
@@ -142,16 +662,15 @@ def generate_peripheral( peripheral ):
          s += v
          s += "\n"
       
+   s += interrupt_enum( peripheral )
+   s += interrupt_dispatcher( peripheral, peripheral )
    return s
 
-def generate_chip( manufacturer, chip ):
-   device = SVDParser.for_packaged_svd( manufacturer, chip + ".svd" ).get_device()
+def read_device( manufacturer, chip ):
+   return SVDParser.for_packaged_svd( manufacturer, chip + ".svd" ).get_device()
+
+def generate_device_banner( device ):
    s = ""
-   
-   s += "#include \"hardware_registers.hpp\"\n"
-   s += "namespace %s = hardware_registers;\n" % prefix
-   s += "\n"
-   
    s += separator
    s += "//\n"
    s += "// %s\n" % device.name
@@ -160,13 +679,173 @@ def generate_chip( manufacturer, chip ):
    s += "//\n"
    s += separator
    s += "\n"
+   return s
+
+# the access policy of all registers (direct_access, relaxed_access,
+# traced_access or simulated_access), None for the library default
+access_policy = None
+
+# the hardware_registers.hpp configuration macros for the device,
+# to be defined before hardware_registers.hpp is included
+def configuration( device ):
+   defines = []
+   cpu = getattr( device, "cpu", None )
+   if cpu != None and svd_attribute( cpu, "name" ) in [ "CM3", "CM4" ]:
+      defines.append( ( "HARDWARE_REGISTERS_BIT_BAND", "" ) )
+   if cpu != None and svd_attribute( cpu, "nvic_prio_bits" ) != None:
+      defines.append( ( "HARDWARE_REGISTERS_NVIC_PRIORITY_BITS", 
+         " %d" % svd_attribute( cpu, "nvic_prio_bits" ) ) )
+   if access_policy != None:
+      defines.append( ( "HARDWARE_REGISTERS_ACCESS_POLICY", " " + access_policy ) )
+   s = ""
+   for define, value in defines:
+      s += "#ifndef %s\n" % define
+      s += "#define %s%s\n" % ( define, value )
+      s += "#endif\n"
+   return s
+
+def generate_chip( device ):
+   s = ""
+   
+   s += configuration( device )
+   s += "#include \"hardware_registers.hpp\"\n"
+   s += "namespace %s = hardware_registers;\n" % prefix
+   s += "\n"
+   
+   s += generate_device_banner( device )
+   s += generate_interrupts( device )
+   
+   shared = shared_peripherals( device )
+   structs = shared_structs( device )
+   for peripheral in device.peripherals:
+      s += generate_peripheral( peripheral, shared.get( peripheral.name ),
+         struct_shared = peripheral.name in structs )
+      
+   return s
+
+def include_guard( chip_name, name ):
+   return "%s_%s_HPP" % ( chip_name.upper(), name.upper() )
+
+def peripheral_file_name( peripheral ):
+   return "%s.hpp" % peripheral.name.lower()
+
+# the Irq enum, included by the headers of peripherals with interrupts
+interrupts_file_name = "interrupts.hpp"
+
+def generate_interrupts_header( device, chip_name ):
+   guard = include_guard( chip_name, "interrupts" )
+   s = ""
+   s += "#ifndef %s\n" % guard
+   s += "#define %s\n" % guard
+   s += "\n"
+   s += generate_interrupts( device )
+   s += "#endif // %s\n" % guard
+   return s
+
+def generate_peripheral_header( device, chip_name, peripheral, shared_with ):
+   guard = include_guard( chip_name, peripheral.name )
+   s = ""
+   s += "#ifndef %s\n" % guard
+   s += "#define %s\n" % guard
+   s += "\n"
+   s += configuration( device )
+   s += "#include \"hardware_registers.hpp\"\n"
+   if shared_with != None:
+      s += "#include \"%s\"\n" % peripheral_file_name( shared_with )
+   if ( getattr( peripheral, "interrupts", None ) or [] ) != []:
+      s += "#include \"%s\"\n" % interrupts_file_name
+   s += "namespace %s = hardware_registers;\n" % prefix
+   s += "\n"
+   s += generate_peripheral( peripheral, shared_with, 
+      struct_shared = peripheral.name in shared_structs( device ) )
+   s += "#endif // %s\n" % guard
+   return s
+
+# returns a { file_name : text } dictionary: one header per peripheral,
+# plus an umbrella header <chip_name>.hpp that includes all of them
+def generate_split_chip( device, chip_name ):
+   files = {}
+   guard = "%s_HPP" % chip_name.upper()
+   
+   s = ""
+   s += "#ifndef %s\n" % guard
+   s += "#define %s\n" % guard
+   s += "\n"
+   s += generate_device_banner( device )
+   
+   if device_interrupts( device ) != []:
+      files[ interrupts_file_name ] = generate_interrupts_header( device, chip_name )
+      s += "#include \"%s\"\n" % interrupts_file_name
    
+   shared = shared_peripherals( device )
    for peripheral in device.peripherals:
-      s += generate_peripheral( peripheral )
+      file_name = peripheral_file_name( peripheral )
+      files[ file_name ] = generate_peripheral_header( 
+         device, chip_name, peripheral, shared.get( peripheral.name ) )
+      s += "#include \"%s\"\n" % file_name
       
+   s += "\n"
+   s += "#endif // %s\n" % guard
+   files[ "%s.hpp" % chip_name ] = s
+   return files
+
+# standard headers that hardware_registers.hpp includes: in a module
+# they must be included in the global module fragment
+module_global_includes = [ "<cstdint>" ]
+
+# returns the text of a C++20 module interface unit that exports
+# everything the monolithic header provides
+def generate_module( device, module_name ):
+   s = ""
+   s += "module;\n"
+   for include in module_global_includes:
+      s += "#include %s\n" % include
+   s += "\n"
+   s += "export module %s;\n" % module_name
+   s += "\n"
+   s += "export {\n"
+   s += "\n"
+   s += configuration( device )
+   s += "#include \"hardware_registers.hpp\"\n"
+   s += "namespace %s = hardware_registers;\n" % prefix
+   s += "\n"
+   
+   s += generate_device_banner( device )
+   s += generate_interrupts( device )
+   
+   # namespace-scope constexpr variables have internal linkage,
+   # inline gives them the external linkage required for export
+   shared = shared_peripherals( device )
+   structs = shared_structs( device )
+   for peripheral in device.peripherals:
+      s += generate_peripheral( 
+         peripheral, shared.get( peripheral.name ), module = True,
+         struct_shared = peripheral.name in structs ).replace( 
+         "constexpr auto ", "inline constexpr auto " )
+      
+   s += "} // export\n"
    return s
 
-# s = generate_chip( "STMicro", "STM32F401x" )
-s = generate_chip( "Atmel", "ATSAM3X8E" )
-open( "header.hpp", "w" ).write( s )
+# The checked-in header.hpp is not made from the packaged Atmel SVD, 
+# but from one derived by hand from the previous header, the vendor 
+# sam3x8e.h and the datasheet: only the registers with a reset value 
+# in the datasheet tables have one, the status registers that are 
+# cleared by a read have readAction clear, and there are no 
+# modifiedWriteValues (the SAM3X clears its flags through separate
+# write-only registers).
+
+# device = read_device( "STMicro", "STM32F401x" )
+# chip_name = "stm32f401x"
+device = read_device( "Atmel", "ATSAM3X8E" )
+chip_name = "sam3x8e"
+
+# everything in one header
+open( "header.hpp", "w" ).write( generate_chip( device ) )
+
+# one header per peripheral, plus the umbrella header
+for file_name, s in generate_split_chip( device, chip_name ).items():
+   open( file_name, "w" ).write( s )
 
+# the same, as a module interface unit
+open( "%s.cppm" % chip_name, "w" ).write( 
+   generate_module( device, "chip.%s" % chip_name ) )
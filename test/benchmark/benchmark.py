@@ -0,0 +1,182 @@
+# compile-time benchmark for the hardware_registers templates
+#
+# Compiles a number of synthetic translation units, plus the generated
+# header and test/native/test/main.cpp, with each available compiler,
+# and records per case
+#    - wall time (best of a number of runs)
+#    - peak resident set size of the compiler
+#    - number of template instantiations (clang only, from -ftime-trace)
+#
+# python benchmark.py          run and compare with the last saved results
+# python benchmark.py save     same, and append the results to results.txt
+#
+# The exit status is 1 when a case is more than <tolerance> slower or
+# bigger than in the last saved results for the same compiler.
+
+import glob, json, os, subprocess, sys, tempfile, time
+
+here = os.path.dirname( os.path.abspath( __file__ ) )
+library = os.path.join( here, "..", "native", "test" )
+results_file = os.path.join( here, "results.txt" )
+
+compilers = [ "g++", "clang++" ]
+flags = [ "-std=c++20", "-Wno-volatile", "-O2", "-c", "-I" + library ]
+runs = 3
+tolerance = 1.10
+
+
+# ===========================================================================
+#
+# synthetic translation units
+#
+# ===========================================================================
+
+prolog = "#include \"hardware_registers.hpp\"\nnamespace hr = hardware_registers;\n\n"
+
+# n read-modify-write updates, each of a different field,
+# spread over n / 8 registers
+def register_updates( n ):
+   s = prolog
+   s += "struct peripheral {\n"
+   for r in range( ( n + 7 ) // 8 ):
+      s += "   hr::hardware_register< 0x%08x > R%d;\n" % ( 0x40000000 + 4 * r, r )
+   s += "};\n\n"
+   s += "#define P ( ( peripheral * ) 0x40000000 )\n\n"
+   s += "void f(){\n"
+   for i in range( n ):
+      r, field = i // 8, i % 8
+      s += "   P->R%d = ( P->R%d & ~ hr::field_mask_literal< 0x%08x, %d, 4 >() )\n" % (
+         r, r, 0x40000000 + 4 * r, 4 * field )
+      s += "      | hr::field_value_literal< 0x%08x, %d, 4 >( %d );\n" % (
+         0x40000000 + 4 * r, 4 * field, i % 16 )
+   s += "}\n"
+   return s
+
+# one |= with an operator| chain of n single-bit field values
+def or_chain( n ):
+   s = prolog
+   s += "struct peripheral {\n"
+   s += "   hr::hardware_register< 0x40000000 > R;\n"
+   s += "};\n\n"
+   s += "#define P ( ( peripheral * ) 0x40000000 )\n\n"
+   s += "void f(){\n"
+   s += "   P->R |=\n      "
+   s += "\n      | ".join(
+      "hr::field_value_literal< 0x40000000, %d, 1 >( 1 )" % ( i % 32 )
+      for i in range( n ) )
+   s += ";\n}\n"
+   return s
+
+def header_only():
+   return "#include \"header.hpp\"\n"
+
+cases = [
+   ( "updates-10",     register_updates( 10 ) ),
+   ( "updates-100",    register_updates( 100 ) ),
+   ( "updates-1000",   register_updates( 1000 ) ),
+   ( "or-chain-2",     or_chain( 2 ) ),
+   ( "or-chain-8",     or_chain( 8 ) ),
+   ( "or-chain-32",    or_chain( 32 ) ),
+   ( "header.hpp",     header_only() ),
+   ( "main.cpp",       open( os.path.join( library, "main.cpp" ) ).read() ),
+]
+
+
+# ===========================================================================
+#
+# measurement
+#
+# ===========================================================================
+
+def available( compiler ):
+   try:
+      return subprocess.run(
+         [ compiler, "--version" ], stdout = subprocess.DEVNULL,
+         stderr = subprocess.DEVNULL ).returncode == 0
+   except FileNotFoundError:
+      return False
+
+# runs the command, returns ( wall time, peak rss in kB, exit status )
+def measure( command, directory ):
+   start = time.perf_counter()
+   process = subprocess.Popen(
+      command, cwd = directory,
+      stdout = subprocess.DEVNULL, stderr = subprocess.DEVNULL )
+   pid, status, usage = os.wait4( process.pid, 0 )
+   return time.perf_counter() - start, usage.ru_maxrss, status
+
+def instantiations( directory ):
+   n = 0
+   for file_name in glob.glob( os.path.join( directory, "*.json" ) ):
+      for event in json.load( open( file_name ) )[ "traceEvents" ]:
+         if event.get( "name" ) in [ "InstantiateClass", "InstantiateFunction" ]:
+            n += 1
+   return n
+
+def run_case( compiler, source ):
+   with tempfile.TemporaryDirectory() as directory:
+      open( os.path.join( directory, "case.cpp" ), "w" ).write( source )
+      command = [ compiler ] + flags + [ "case.cpp" ]
+      if compiler.startswith( "clang" ):
+         command += [ "-ftime-trace" ]
+      best, rss, status = None, 0, 0
+      for n in range( runs ):
+         elapsed, peak, status = measure( command, directory )
+         if best == None or elapsed < best:
+            best = elapsed
+         rss = max( rss, peak )
+      count = instantiations( directory ) if compiler.startswith( "clang" ) else None
+      return best, rss, count, status
+
+
+# ===========================================================================
+#
+# results
+#
+# a results.txt line is: date compiler case seconds kB instantiations
+#
+# ===========================================================================
+
+def saved_results():
+   last = {}
+   if os.path.exists( results_file ):
+      for line in open( results_file ):
+         if line.strip() == "" or line.startswith( "#" ):
+            continue
+         date, compiler, case, seconds, rss, count = line.split()
+         last[ ( compiler, case ) ] = ( float( seconds ), int( rss ) )
+   return last
+
+def main():
+   save = "save" in sys.argv[ 1 : ]
+   last = saved_results()
+   date = time.strftime( "%Y-%m-%d" )
+   lines = []
+   regressions = 0
+
+   for compiler in compilers:
+      if not available( compiler ):
+         print( "%s: not available, skipped" % compiler )
+         continue
+      version = subprocess.run(
+         [ compiler, "--version" ], capture_output = True,
+         text = True ).stdout.splitlines()[ 0 ]
+      print( version )
+      for name, source in cases:
+         seconds, rss, count, status = run_case( compiler, source )
+         note = "" if status == 0 else "  (compiler reported errors)"
+         if ( compiler, name ) in last:
+            old_seconds, old_rss = last[ ( compiler, name ) ]
+            if seconds > tolerance * old_seconds or rss > tolerance * old_rss:
+               note += "  REGRESSION (was %.3f s, %d kB)" % ( old_seconds, old_rss )
+               regressions += 1
+         print( "   %-14s %8.3f s %9d kB %8s%s" % (
+            name, seconds, rss, "-" if count == None else count, note ) )
+         lines.append( "%s %s %s %.3f %d %s\n" % (
+            date, compiler, name, seconds, rss, "-" if count == None else count ) )
+
+   if save:
+      open( results_file, "a" ).writelines( lines )
+   return 1 if regressions > 0 else 0
+
+sys.exit( main() )
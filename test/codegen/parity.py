@@ -0,0 +1,167 @@
+# codegen parity check: typed hardware_registers code versus raw
+# volatile code written with the vendor sam3x8e.h macros
+#
+# typed.cpp and raw.cpp contain the same access patterns as
+# extern "C" functions typed_<name> and raw_<name>. Both are compiled
+# at each optimization level, disassembled, and for each pair the
+# instructions, loads and stores are counted. The check fails when a
+# typed_ function needs more of any of these than its raw_ counterpart.
+#
+# At -O0 the typed_ functions are only checked to contain no calls:
+# the access layer must be inlined even in a debug build.
+#
+# python parity.py
+#
+# The compiler, objdump and nm can be set with the CXX, OBJDUMP and
+# NM environment variables. The default is the arm-none-eabi toolchain
+# for the Cortex-M3 of the Arduino Due. With a host toolchain the
+# comparison is still meaningful, only for another instruction set.
+#
+# VENDOR_INCLUDE is the search path for sam3x8e.h and the CMSIS
+# headers it includes, the default is the bmptk copy next to this repo.
+
+import os, re, subprocess, sys, tempfile
+
+here = os.path.dirname( os.path.abspath( __file__ ) )
+library = os.path.join( here, "..", "native", "test" )
+bmptk = os.path.join( here, "..", "..", "..", "bmptk", "targets", "cortex" )
+
+compiler = os.environ.get( "CXX", "arm-none-eabi-g++" )
+objdump = os.environ.get( "OBJDUMP", "arm-none-eabi-objdump" )
+nm = os.environ.get( "NM", "arm-none-eabi-nm" )
+vendor_include = os.environ.get( "VENDOR_INCLUDE", os.pathsep.join( [
+   os.path.join( bmptk, "atmel", "sam3xa", "include" ),
+   os.path.join( bmptk, "cmsis" ) ] ) ).split( os.pathsep )
+
+arm = "arm" in compiler
+flags = [ "-std=c++20", "-Wno-volatile", "-c" ]
+if arm:
+   flags += [ "-mcpu=cortex-m3", "-mthumb" ]
+levels = [ "-O2", "-Os" ]
+debug_level = "-O0"
+
+sources = [
+   ( "typed.cpp", [ "-I" + library ] ),
+   ( "raw.cpp",   [ "-I" + path for path in vendor_include ] + [ "-D__SAM3X8E__" ] ),
+]
+
+
+# ===========================================================================
+#
+# disassembly
+#
+# ===========================================================================
+
+# returns { function : [ ( mnemonic, operands ), ... ] }
+def disassemble( object_file ):
+   sizes = {}
+   for line in subprocess.run( [ nm, "-S", "--defined-only", object_file ],
+         capture_output = True, text = True, check = True ).stdout.splitlines():
+      fields = line.split()
+      if len( fields ) == 4 and fields[ 2 ] in "tT":
+         sizes[ fields[ 3 ] ] = ( int( fields[ 0 ], 16 ), int( fields[ 1 ], 16 ) )
+
+   functions = {}
+   current = None
+   for line in subprocess.run( [ objdump, "-d", "--no-show-raw-insn", object_file ],
+         capture_output = True, text = True, check = True ).stdout.splitlines():
+      match = re.match( r"[0-9a-f]+ <(\w+)>:", line )
+      if match:
+         current = match.group( 1 ) if match.group( 1 ) in sizes else None
+         if current != None:
+            functions[ current ] = []
+         continue
+      match = re.match( r"\s*([0-9a-f]+):\s+(\S+)\s*(.*)", line )
+      if current != None and match:
+         start, size = sizes[ current ]
+         # skip alignment padding and literal pool data
+         if int( match.group( 1 ), 16 ) < start + size and not match.group( 2 ).startswith( ( ".", "nop" ) ):
+            functions[ current ].append( ( match.group( 2 ), match.group( 3 ) ) )
+   return functions
+
+def is_load( mnemonic, operands ):
+   if arm:
+      return mnemonic.startswith( ( "ldr", "ldm", "pop" ) )
+   operands = split_operands( operands )
+   if mnemonic.startswith( "lea" ) or len( operands ) == 0:
+      return False
+   # a memory source, or a memory destination that is read first
+   return any( is_memory( operand ) for operand in operands[ : -1 ] ) or ( 
+      is_memory( operands[ -1 ] ) and not mnemonic.startswith( "mov" ) )
+
+def is_store( mnemonic, operands ):
+   if arm:
+      return mnemonic.startswith( ( "str", "stm", "push" ) )
+   operands = split_operands( operands )
+   return len( operands ) > 0 and is_memory( operands[ -1 ] ) and ( 
+      not mnemonic.startswith( ( "cmp", "test" ) ) )
+
+# x86 (AT&T syntax) helpers
+def split_operands( operands ):
+   return [ op for op in re.split( r",(?![^(]*\))", operands.split( "#" )[ 0 ].strip() ) if op ]
+
+def is_memory( operand ):
+   return "(" in operand or re.fullmatch( r"0x[0-9a-f]+", operand ) != None
+
+def is_call( mnemonic, operands ):
+   if arm:
+      return mnemonic in [ "bl", "blx" ]
+   return mnemonic.startswith( "call" )
+
+def count( instructions ):
+   return {
+      "instructions" : len( instructions ),
+      "loads"        : sum( is_load( m, o ) for m, o in instructions ),
+      "stores"       : sum( is_store( m, o ) for m, o in instructions ),
+   }
+
+def calls( instructions ):
+   return sum( is_call( m, o ) for m, o in instructions )
+
+
+# ===========================================================================
+#
+# the check
+#
+# ===========================================================================
+
+# returns { function : counts } for the functions of both sources
+def compile_and_count( directory, level, count = count ):
+   counts = {}
+   for source, extra in sources:
+      object_file = os.path.join( directory, source + level + ".o" )
+      subprocess.run( [ compiler ] + flags + extra + [ level,
+         os.path.join( here, source ), "-o", object_file ], check = True )
+      for function, instructions in disassemble( object_file ).items():
+         counts[ function ] = count( instructions )
+   return counts
+
+def main():
+   failures = 0
+   with tempfile.TemporaryDirectory() as directory:
+      for level in levels:
+         counts = compile_and_count( directory, level )
+         print( "%s %s" % ( compiler, level ) )
+         print( "   %-24s %16s %16s %16s" % ( "", "instructions", "loads", "stores" ) )
+         for function in sorted( counts ):
+            if not function.startswith( "typed_" ):
+               continue
+            name = function[ len( "typed_" ) : ]
+            typed, raw = counts[ function ], counts[ "raw_" + name ]
+            worse = [ key for key in typed if typed[ key ] > raw[ key ] ]
+            failures += len( worse ) > 0
+            print( "   %-24s %16s %16s %16s%s" % ( name,
+               *( "%d / %d" % ( typed[ key ], raw[ key ] ) for key in typed ),
+               "" if len( worse ) == 0 else "  FAIL: more " + ", ".join( worse ) ) )
+
+      counts = compile_and_count( directory, debug_level, calls )
+      print( "%s %s" % ( compiler, debug_level ) )
+      for function in sorted( counts ):
+         if function.startswith( "typed_" ):
+            failures += counts[ function ] > 0
+            print( "   %-24s %16d calls%s" % ( function[ len( "typed_" ) : ], 
+               counts[ function ], "" if counts[ function ] == 0 else "  FAIL" ) )
+   print( "typed / raw, %d failure(s)" % failures )
+   return 1 if failures > 0 else 0
+
+sys.exit( main() )
@@ -0,0 +1,155 @@
+// ============================================================================
+//
+// The access patterns of typed.cpp, written as raw volatile accesses
+// with the vendor sam3x8e.h macros. This is the reference that 
+// parity.py compares the typed_ functions with.
+//
+// ============================================================================
+
+#include "sam3x8e.h"
+
+extern "C" {
+   
+// register &= ~ fields_mask
+void raw_and_not_mask(){
+   PMC->PMC_MCKR &= ~PMC_MCKR_CSS_Msk;
+}
+
+// register |= fields_value
+void raw_or_value(){
+   PMC->PMC_MCKR |= PMC_MCKR_CSS_MAIN_CLK;
+}
+
+// register = ( register & ~ fields_mask ) | fields_value
+void raw_replace_field(){
+   PMC->PMC_MCKR = ( PMC->PMC_MCKR & ~PMC_MCKR_CSS_Msk ) | PMC_MCKR_CSS_MAIN_CLK;
+}
+
+// register = fields_mask | fields_mask ...
+void raw_write_fields(){
+   PMC->CKGR_MOR = CKGR_MOR_MOSCRCEN | CKGR_MOR_MOSCXTEN | CKGR_MOR_MOSCSEL;
+}
+
+// register = fields_mask (write-only register)
+void raw_enable_clocks(){
+   PMC->PMC_PCER0 = PMC_PCER0_PID11 | PMC_PCER0_PID12 | PMC_PCER0_PID13;
+}
+
+// register & fields_mask
+void raw_wait_flag(){
+   while( !( PMC->PMC_SR & PMC_SR_MCKRDY ) ){}
+}
+
+// ( register & fields_mask ) == fields_value
+bool raw_read_field(){
+   return ( PMC->PMC_MCKR & PMC_MCKR_CSS_Msk ) == PMC_MCKR_CSS_PLLA_CLK;
+}
+
+// several updates of one register, committed as one read-modify-write
+void raw_coalesced_update(){
+   PMC->PMC_MCKR = ( PMC->PMC_MCKR & ~( PMC_MCKR_CSS_Msk | PMC_MCKR_PRES_Msk ) ) | PMC_MCKR_CSS_MAIN_CLK;
+}
+
+// register <<= fields_value + fields_value, with run-time values
+void raw_runtime_fields( uint32_t multiplier, uint32_t divider ){
+   PMC->CKGR_PLLAR = ( PMC->CKGR_PLLAR & ~( CKGR_PLLAR_MULA_Msk | CKGR_PLLAR_DIVA_Msk ) ) 
+      | CKGR_PLLAR_MULA( multiplier - 1 ) | CKGR_PLLAR_DIVA( divider );
+}
+
+// first write after reset: fields merged with the reset value, one store
+void raw_initialize( uint32_t multiplier ){
+   PMC->CKGR_PLLAR = CKGR_PLLAR_ONE | CKGR_PLLAR_MULA( multiplier - 1 ) | CKGR_PLLAR_DIVA( 1 );
+}
+
+// clock switch sequence from test/native/test/main.cpp
+void raw_system_init_clock(){
+   PMC->CKGR_MOR = CKGR_MOR_MOSCRCEN | CKGR_MOR_MOSCXTEN | CKGR_MOR_MOSCSEL;
+   while( !( PMC->PMC_SR & PMC_SR_MOSCSELS ) ){}
+   PMC->PMC_MCKR = ( PMC->PMC_MCKR & ~PMC_MCKR_CSS_Msk ) | PMC_MCKR_CSS_MAIN_CLK;
+   while( !( PMC->PMC_SR & PMC_SR_MCKRDY ) ){}
+   while( !( PMC->PMC_SR & PMC_SR_LOCKA ) ){}
+   PMC->PMC_MCKR = ( PMC->PMC_MCKR & ~PMC_MCKR_CSS_Msk ) | PMC_MCKR_CSS_MAIN_CLK;
+   while( !( PMC->PMC_SR & PMC_SR_MCKRDY ) ){}
+}
+
+// SystemCoreClock calculation from test/native/test/main.cpp
+uint32_t raw_core_clock(){
+   uint32_t clock = 4'000'000;
+   switch( PMC->PMC_MCKR & PMC_MCKR_CSS_Msk ){
+      case PMC_MCKR_CSS_SLOW_CLK:
+         clock = ( SUPC->SUPC_SR & SUPC_SR_OSCSEL ) ? 32'768 : 32'000;
+         break;
+      case PMC_MCKR_CSS_MAIN_CLK:
+      case PMC_MCKR_CSS_PLLA_CLK:
+      case PMC_MCKR_CSS_UPLL_CLK:
+         if( PMC->CKGR_MOR & CKGR_MOR_MOSCSEL ){
+            clock = 12'000'000;
+         } else {
+            switch( PMC->CKGR_MOR & CKGR_MOR_MOSCRCF_Msk ){
+               case CKGR_MOR_MOSCRCF_8_MHz:  clock *= 2; break;
+               case CKGR_MOR_MOSCRCF_12_MHz: clock *= 3; break;
+               default: break;
+            }
+         }
+         if( ( PMC->PMC_MCKR & PMC_MCKR_CSS_Msk ) == PMC_MCKR_CSS_PLLA_CLK ){
+            clock *= ( ( PMC->CKGR_PLLAR & CKGR_PLLAR_MULA_Msk ) >> CKGR_PLLAR_MULA_Pos ) + 1;
+         }
+         break;
+   }
+   if( ( PMC->PMC_MCKR & PMC_MCKR_PRES_Msk ) == PMC_MCKR_PRES_CLK_3 ){
+      clock /= 3;
+   } else {
+      clock >>= ( PMC->PMC_MCKR & PMC_MCKR_PRES_Msk ) >> PMC_MCKR_PRES_Pos;
+   }
+   return clock;
+}
+
+// SystemCoreClock calculation, with each register read only once
+uint32_t raw_core_clock_snapshot(){
+   uint32_t mckr = PMC->PMC_MCKR;
+   uint32_t mor = PMC->CKGR_MOR;
+   uint32_t clock = 4'000'000;
+   switch( mckr & PMC_MCKR_CSS_Msk ){
+      case PMC_MCKR_CSS_SLOW_CLK:
+         clock = ( SUPC->SUPC_SR & SUPC_SR_OSCSEL ) ? 32'768 : 32'000;
+         break;
+      case PMC_MCKR_CSS_MAIN_CLK:
+      case PMC_MCKR_CSS_PLLA_CLK:
+      case PMC_MCKR_CSS_UPLL_CLK:
+         if( mor & CKGR_MOR_MOSCSEL ){
+            clock = 12'000'000;
+         } else {
+            switch( mor & CKGR_MOR_MOSCRCF_Msk ){
+               case CKGR_MOR_MOSCRCF_8_MHz:  clock *= 2; break;
+               case CKGR_MOR_MOSCRCF_12_MHz: clock *= 3; break;
+               default: break;
+            }
+         }
+         if( ( mckr & PMC_MCKR_CSS_Msk ) == PMC_MCKR_CSS_PLLA_CLK ){
+            clock *= ( ( PMC->CKGR_PLLAR & CKGR_PLLAR_MULA_Msk ) >> CKGR_PLLAR_MULA_Pos ) + 1;
+         }
+         break;
+   }
+   if( ( mckr & PMC_MCKR_PRES_Msk ) == PMC_MCKR_PRES_CLK_3 ){
+      clock /= 3;
+   } else {
+      clock >>= ( mckr & PMC_MCKR_PRES_Msk ) >> PMC_MCKR_PRES_Pos;
+   }
+   return clock;
+}
+
+// three adjacent registers written with full values
+void raw_burst( uint32_t brgr, uint32_t rtor, uint32_t ttgr ){
+   USART0->US_BRGR = brgr;
+   USART0->US_RTOR = rtor;
+   USART0->US_TTGR = ttgr;
+}
+
+// the 4 response registers copied to a buffer
+void raw_block( uint32_t * response ){
+   for( int i = 0; i < 4; ++i ){
+      response[ i ] = HSMCI->HSMCI_RSPR[ i ];
+   }
+}
+
+}
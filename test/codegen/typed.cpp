@@ -0,0 +1,158 @@
+// ============================================================================
+//
+// Access patterns written with the typed hardware_registers header.
+//
+// Each function here has a counterpart with the same name, but with
+// a raw_ instead of a typed_ prefix, in raw.cpp, written with the 
+// vendor sam3x8e.h macros. parity.py checks that each typed_ function
+// compiles to no more instructions, loads and stores than its raw_
+// counterpart.
+//
+// ============================================================================
+
+#include "header.hpp"
+
+extern "C" {
+   
+// register &= ~ fields_mask
+void typed_and_not_mask(){
+   PMC->PMC_MCKR &= ~PMC_MCKR_CSS_Msk;
+}
+
+// register |= fields_value
+void typed_or_value(){
+   PMC->PMC_MCKR |= PMC_MCKR_CSS_MAIN_CLK;
+}
+
+// register = ( register & ~ fields_mask ) | fields_value
+void typed_replace_field(){
+   PMC->PMC_MCKR = ( PMC->PMC_MCKR & ~PMC_MCKR_CSS_Msk ) | PMC_MCKR_CSS_MAIN_CLK;
+}
+
+// register = fields_mask | fields_mask ...
+void typed_write_fields(){
+   PMC->CKGR_MOR = CKGR_MOR_MOSCRCEN | CKGR_MOR_MOSCXTEN | CKGR_MOR_MOSCSEL;
+}
+
+// register = fields_mask (write-only register)
+void typed_enable_clocks(){
+   PMC->PMC_PCER0 = PMC_PCER0_PID< 11 > | PMC_PCER0_PID< 12 > | PMC_PCER0_PID< 13 >;
+}
+
+// register & fields_mask
+void typed_wait_flag(){
+   while( !( PMC->PMC_SR & PMC_SR_MCKRDY ) ){}
+}
+
+// ( register & fields_mask ) == fields_value
+bool typed_read_field(){
+   return ( PMC->PMC_MCKR & PMC_MCKR_CSS_Msk ) == PMC_MCKR_CSS_PLLA_CLK;
+}
+
+// several updates of one register, committed as one read-modify-write
+void typed_coalesced_update(){
+   auto mckr = PMC->PMC_MCKR.transaction();
+   mckr &= ~PMC_MCKR_CSS_Msk;
+   mckr |= PMC_MCKR_CSS_MAIN_CLK;
+   mckr &= ~PMC_MCKR_PRES_Msk;
+}
+
+// register <<= fields_value + fields_value, with run-time values
+void typed_runtime_fields( uint32_t multiplier, uint32_t divider ){
+   PMC->CKGR_PLLAR <<= CKGR_PLLAR_MULA_Msk( multiplier - 1 ) + CKGR_PLLAR_DIVA_Msk( divider );
+}
+
+// first write after reset: fields merged with the reset value, one store
+void typed_initialize( uint32_t multiplier ){
+   PMC->CKGR_PLLAR.initialize( CKGR_PLLAR_ONE( 1 ) + CKGR_PLLAR_MULA_Msk( multiplier - 1 ) + CKGR_PLLAR_DIVA_Msk( 1 ) );
+}
+
+// clock switch sequence from test/native/test/main.cpp
+void typed_system_init_clock(){
+   PMC->CKGR_MOR = CKGR_MOR_MOSCRCEN | CKGR_MOR_MOSCXTEN | CKGR_MOR_MOSCSEL;
+   while( !( PMC->PMC_SR & PMC_SR_MOSCSELS ) ){}
+   PMC->PMC_MCKR = ( PMC->PMC_MCKR & ~PMC_MCKR_CSS_Msk ) | PMC_MCKR_CSS_MAIN_CLK;
+   while( !( PMC->PMC_SR & PMC_SR_MCKRDY ) ){}
+   while( !( PMC->PMC_SR & PMC_SR_LOCKA ) ){}
+   PMC->PMC_MCKR = ( PMC->PMC_MCKR & ~PMC_MCKR_CSS_Msk ) | PMC_MCKR_CSS_MAIN_CLK;
+   while( !( PMC->PMC_SR & PMC_SR_MCKRDY ) ){}
+}
+
+// SystemCoreClock calculation from test/native/test/main.cpp
+uint32_t typed_core_clock(){
+   uint32_t clock = 4'000'000;
+   switch( PMC->PMC_MCKR & PMC_MCKR_CSS_Msk ){
+      case PMC_MCKR_CSS_SLOW_CLK:
+         clock = ( SUPC->SR & SUPC_SR_OSCSEL ) ? 32'768 : 32'000;
+         break;
+      case PMC_MCKR_CSS_MAIN_CLK:
+      case PMC_MCKR_CSS_PLLA_CLK:
+      case PMC_MCKR_CSS_UPLL_CLK:
+         if( PMC->CKGR_MOR & CKGR_MOR_MOSCSEL ){
+            clock = 12'000'000;
+         } else {
+            switch( PMC->CKGR_MOR & CKGR_MOR_MOSCRCF_Msk ){
+               case CKGR_MOR_MOSCRCF_8_MHZ:  clock *= 2; break;
+               case CKGR_MOR_MOSCRCF_12_MHZ: clock *= 3; break;
+               default: break;
+            }
+         }
+         if( ( PMC->PMC_MCKR & PMC_MCKR_CSS_Msk ) == PMC_MCKR_CSS_PLLA_CLK ){
+            clock *= ( ( PMC->CKGR_PLLAR & CKGR_PLLAR_MULA_Msk ) >> 16 ) + 1;
+         }
+         break;
+   }
+   if( ( PMC->PMC_MCKR & PMC_MCKR_PRES_Msk ) == PMC_MCKR_PRES_CLK_3 ){
+      clock /= 3;
+   } else {
+      clock >>= ( PMC->PMC_MCKR & PMC_MCKR_PRES_Msk ) >> 4;
+   }
+   return clock;
+}
+
+// SystemCoreClock calculation, with each register read only once
+uint32_t typed_core_clock_snapshot(){
+   auto mckr = PMC->PMC_MCKR.read();
+   auto mor = PMC->CKGR_MOR.read();
+   uint32_t clock = 4'000'000;
+   switch( mckr & PMC_MCKR_CSS_Msk ){
+      case PMC_MCKR_CSS_SLOW_CLK:
+         clock = ( SUPC->SR & SUPC_SR_OSCSEL ) ? 32'768 : 32'000;
+         break;
+      case PMC_MCKR_CSS_MAIN_CLK:
+      case PMC_MCKR_CSS_PLLA_CLK:
+      case PMC_MCKR_CSS_UPLL_CLK:
+         if( mor & CKGR_MOR_MOSCSEL ){
+            clock = 12'000'000;
+         } else {
+            switch( mor & CKGR_MOR_MOSCRCF_Msk ){
+               case CKGR_MOR_MOSCRCF_8_MHZ:  clock *= 2; break;
+               case CKGR_MOR_MOSCRCF_12_MHZ: clock *= 3; break;
+               default: break;
+            }
+         }
+         if( mckr == PMC_MCKR_CSS_PLLA_CLK ){
+            clock *= PMC->CKGR_PLLAR.read().read( CKGR_PLLAR_MULA_Msk ) + 1;
+         }
+         break;
+   }
+   if( mckr == PMC_MCKR_PRES_CLK_3 ){
+      clock /= 3;
+   } else {
+      clock >>= mckr.read< PMC_MCKR_PRES_Msk >();
+   }
+   return clock;
+}
+
+// three adjacent registers written with full values
+void typed_burst( uint32_t brgr, uint32_t rtor, uint32_t ttgr ){
+   hr::write_burst< &Usart0::BRGR, &Usart0::RTOR, &Usart0::TTGR >( 
+      USART0, brgr, rtor, ttgr );
+}
+
+// the 4 response registers copied to a buffer
+void typed_block( uint32_t * response ){
+   hr::read_block( HSMCI->RSPR, response );
+}
+
+}
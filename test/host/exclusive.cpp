@@ -0,0 +1,196 @@
+// ==========================================================================
+//
+// host test of the interrupt-safe read-modify-write
+//
+// - the exclusive (ldrex/strex) retry, using the simulated exclusive
+//   monitor: each simulated interrupt makes the store fail, and
+//   modifies the register in between
+// - the |= and &= ~ of a register with concurrency exclusive go
+//   through that retry
+// - those of a register with concurrency critical_section are done
+//   with the (simulated) interrupts disabled
+// - those of a register with concurrency none, or exclusive with
+//   another access policy than direct_access, are a single plain
+//   read-modify-write
+//
+// g++ -std=c++20 -I../native/test exclusive.cpp -o exclusive && ./exclusive
+//
+// ==========================================================================
+
+#include <cstdint>
+#include <cstdio>
+
+#include "hardware_registers.hpp"
+
+namespace hr = hardware_registers;
+
+using monitor = hr::simulated_exclusive_monitor;
+using control = hr::simulated_interrupt_control;
+
+// an access policy that counts the loads and stores, and records
+// whether the interrupts were disabled during all of them
+struct counting_access {
+
+   static inline int loads = 0;
+   static inline int stores = 0;
+   static inline bool disabled = true;
+
+   static void reset(){
+      loads = 0;
+      stores = 0;
+      disabled = true;
+   }
+
+   static hr::register_value_type load(
+      const volatile hr::register_value_type & r
+   ){
+      ++loads;
+      disabled = disabled && control::disabled;
+      return r;
+   }
+
+   static void store(
+      volatile hr::register_value_type & r,
+      hr::register_value_type value
+   ){
+      ++stores;
+      disabled = disabled && control::disabled;
+      r = value;
+   }
+};
+
+template< hr::register_concurrency _concurrency >
+using properties = hr::register_properties<
+   hr::register_access::read_write, 0xFFFFFFFF, 0, 0xFFFFFFFF,
+   hr::modified_write::modify, hr::read_action::none, _concurrency >;
+
+// the registers are host variables, their address template
+// parameter only ties them to their fields
+hr::hardware_register< 0x1000,
+   properties< hr::register_concurrency::exclusive > > exclusive_register;
+
+hr::hardware_register< 0x1004,
+   properties< hr::register_concurrency::exclusive >,
+   counting_access > exclusive_counted_register;
+
+hr::hardware_register< 0x1008,
+   properties< hr::register_concurrency::critical_section >,
+   counting_access > critical_register;
+
+hr::hardware_register< 0x100C,
+   properties< hr::register_concurrency::none >,
+   counting_access > plain_register;
+
+volatile hr::register_value_type reg;
+
+volatile hr::register_value_type * interrupted = & reg;
+
+int interrupt_calls = 0;
+
+// the 'interrupt' sets bit 4, which the interrupted
+// modification must not lose
+void interrupt(){
+   ++interrupt_calls;
+   * interrupted = * interrupted | 0x10;
+}
+
+int failures = 0;
+
+void check( bool ok, const char * what ){
+   if( ! ok ){
+      std::printf( "FAILED: %s\n", what );
+      ++failures;
+   }
+}
+
+int main(){
+
+   monitor::interrupt = interrupt;
+
+   // not interrupted: a single load and store
+   reg = 0x0F;
+   monitor::interrupts = 0;
+   hr::exclusive_modify< monitor >( reg, 0x03, 0x40 );
+   check( reg == 0x4C, "uninterrupted modify" );
+   check( interrupt_calls == 0, "no interrupt" );
+
+   // interrupted twice: the retries must see the interrupt's change
+   reg = 0x0F;
+   monitor::interrupts = 2;
+   hr::exclusive_modify< monitor >( reg, 0x03, 0x40 );
+   check( reg == 0x5C, "interrupted modify keeps the interrupt's bit" );
+   check( interrupt_calls == 2, "two interrupts" );
+   check( monitor::interrupts == 0, "all interrupts consumed" );
+
+   // exclusive register |=: retried, keeps the interrupt's bit
+   interrupted = & exclusive_register.the_register;
+   exclusive_register.the_register = 0x01;
+   interrupt_calls = 0;
+   monitor::interrupts = 1;
+   exclusive_register |= hr::field_mask_literal< 0x1000, 6, 1 >();
+   check( exclusive_register.the_register == 0x51,
+      "exclusive |= keeps the interrupt's bit" );
+   check( interrupt_calls == 1, "exclusive |= was retried" );
+
+   // exclusive register &= ~: the same
+   exclusive_register.the_register = 0x03;
+   interrupt_calls = 0;
+   monitor::interrupts = 2;
+   exclusive_register &= ~ hr::field_mask_literal< 0x1000, 0, 1 >();
+   check( exclusive_register.the_register == 0x12,
+      "exclusive &= ~ keeps the interrupt's bit" );
+   check( interrupt_calls == 2, "exclusive &= ~ was retried" );
+
+   // exclusive with another access policy: a plain read-modify-write
+   exclusive_counted_register.the_register = 0x01;
+   counting_access::reset();
+   interrupt_calls = 0;
+   monitor::interrupts = 1;
+   exclusive_counted_register |= hr::field_mask_literal< 0x1004, 6, 1 >();
+   check( exclusive_counted_register.the_register == 0x41,
+      "exclusive via a policy |=" );
+   check( counting_access::loads == 1 && counting_access::stores == 1,
+      "exclusive via a policy is one load and one store" );
+   check( monitor::interrupts == 1 && interrupt_calls == 0,
+      "exclusive via a policy doesn't use the monitor" );
+   monitor::interrupts = 0;
+
+   // critical section: the load and the store with interrupts disabled,
+   // and the interrupts are enabled again afterwards
+   critical_register.the_register = 0x01;
+   counting_access::reset();
+   control::disabled = false;
+   critical_register |= hr::field_mask_literal< 0x1008, 6, 1 >();
+   critical_register &= ~ hr::field_mask_literal< 0x1008, 0, 1 >();
+   check( critical_register.the_register == 0x40, "critical section |= &= ~" );
+   check( counting_access::loads == 2 && counting_access::stores == 2,
+      "critical section is one load and one store per update" );
+   check( counting_access::disabled,
+      "critical section accesses with interrupts disabled" );
+   check( ! control::disabled, "critical section restores the interrupts" );
+
+   // a critical section in a critical section leaves them disabled
+   control::disabled = true;
+   critical_register |= hr::field_mask_literal< 0x1008, 1, 1 >();
+   check( control::disabled, "nested critical section stays disabled" );
+   control::disabled = false;
+
+   // concurrency none: one plain load and store, no monitor,
+   // interrupts not disabled
+   plain_register.the_register = 0x01;
+   counting_access::reset();
+   monitor::interrupts = 1;
+   plain_register |= hr::field_mask_literal< 0x100C, 6, 1 >();
+   check( plain_register.the_register == 0x41, "none |=" );
+   check( counting_access::loads == 1 && counting_access::stores == 1,
+      "none is one load and one store" );
+   check( ! counting_access::disabled, "none doesn't disable interrupts" );
+   check( monitor::interrupts == 1 && interrupt_calls == 0,
+      "none doesn't use the monitor" );
+   monitor::interrupts = 0;
+
+   monitor::interrupt = nullptr;
+
+   std::printf( "%d failure(s)\n", failures );
+   return failures == 0 ? 0 : 1;
+}
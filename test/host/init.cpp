@@ -0,0 +1,105 @@
+// ==========================================================================
+//
+// host test of the init steps: each step must access the register
+// of the peripheral it is meant for, also for a peripheral that uses
+// the struct of another one (PIOB uses that of PIOA)
+//
+// initialize must only be accepted for a register of which all
+// other bits have a known reset value.
+//
+// The accesses are done via the simulated access policy, which
+// records them in a small simulated memory.
+//
+// g++ -std=c++20 -Wno-volatile -I../native/test init.cpp -o init && ./init
+//
+// ==========================================================================
+
+#include <cstdint>
+#include <cstdio>
+
+#define HARDWARE_REGISTERS_ACCESS_POLICY simulated_access
+#include "header.hpp"
+
+// a step for the register _member with the default base,
+// accepted only when the struct has a base_address
+template< auto _member >
+constexpr bool default_base_accepted = requires {
+   hr::init_write< _member >( PIOB_PER_P< 27 > );
+};
+
+// Piob is Pioa: without a base the step would be for PIOA
+static_assert( ! default_base_accepted< &Piob::PER > );
+static_assert( ! default_base_accepted< &Pioa::PER > );
+
+template< typename _register, typename _value >
+constexpr bool initialize_accepted = requires( _register & r, _value v ){
+   r.initialize( v );
+};
+
+// the reset values from the datasheet
+static_assert( initialize_accepted< 
+   decltype( Pmc::CKGR_PLLAR ), decltype( CKGR_PLLAR_ONE ) > );
+static_assert( initialize_accepted< 
+   decltype( Pmc::CKGR_UCKR ), decltype( CKGR_UCKR_UPLLEN ) > );
+static_assert( decltype( Pmc::CKGR_UCKR )::properties::reset_value 
+   == 0x10200800 );
+static_assert( decltype( Wdt::MR )::properties::reset_value == 0x3fff2fff );
+static_assert( decltype( Uotghs::CTRL )::properties::reset_value 
+   == 0x03004000 );
+
+// the other registers have no known reset value
+static_assert( ! initialize_accepted< 
+   decltype( Pioa::ODSR ), decltype( PIOA_ODSR_P< 3 > ) > );
+
+struct access {
+   hr::register_address_type  address;
+   hr::register_value_type    value;
+};
+
+access writes[ 8 ];
+int number_of_writes = 0;
+
+hr::register_value_type read( hr::register_address_type address ){
+   // PMC_SR: MCKRDY set
+   return address == 0x400e0668 ? 0x8 : 0;
+}
+
+void write( hr::register_address_type address, hr::register_value_type value ){
+   if( number_of_writes < 8 ){
+      writes[ number_of_writes++ ] = { address, value };
+   }
+}
+
+int failures = 0;
+
+void check( bool ok, const char * what ){
+   if( ! ok ){
+      std::printf( "FAILED: %s\n", what );
+      ++failures;
+   }
+}
+
+constexpr auto pins = hr::init_sequence(
+   hr::init_write< &Piob::PER, 0x400e1000 >( PIOB_PER_P< 27 > ),
+   hr::init_write< &Pioa::PER, 0x400e0e00 >( PIOA_PER_P< 8 > ),
+   hr::init_write< &Pmc::PMC_PCER0 >( PMC_PCER0_PID< 12 > ),
+   hr::init_wait_set< &Pmc::PMC_SR >( PMC_SR_MCKRDY )
+);
+
+int main(){
+   hr::simulated_access::read = read;
+   hr::simulated_access::write = write;
+
+   hr::run( pins );
+
+   check( number_of_writes == 3, "three writes" );
+   check( writes[ 0 ].address == 0x400e1000, "PIOB PER at the PIOB base" );
+   check( writes[ 0 ].value == 1u << 27, "PIOB PER value" );
+   check( writes[ 1 ].address == 0x400e0e00, "PIOA PER at the PIOA base" );
+   check( writes[ 1 ].value == 1u << 8, "PIOA PER value" );
+   check( writes[ 2 ].address == 0x400e0610, "PMC PCER0 at the default base" );
+   check( writes[ 2 ].value == 1u << 12, "PMC PCER0 value" );
+
+   std::printf( "%d failure(s)\n", failures );
+   return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,87 @@
+# module check: the generated registers, used from a C++20 module
+#
+# The module interface unit is made from the checked-in header.hpp
+# the way the generator's module output mode makes it: in the global
+# module fragment the standard headers, the header in an export block,
+# its constexpr variables inline (for external linkage), and the
+# peripheral macros as constexpr hr::peripheral objects. use.cpp
+# imports the module and uses the registers, fields, interrupt sets
+# and dispatchers.
+#
+# python module.py
+#
+# The check fails when either compilation fails, including an
+# internal compiler error. The compiler is g++ (with -fmodules-ts),
+# or the one set with the CXX environment variable.
+
+import os, re, shutil, subprocess, sys, tempfile
+
+here = os.path.dirname( os.path.abspath( __file__ ) )
+library = os.path.join( here, "..", "native", "test" )
+
+compiler = os.environ.get( "CXX", "g++" )
+flags = [ "-std=c++20", "-fmodules-ts", "-Wno-volatile", "-O2", "-c" ]
+
+module_name = "chip.sam3x8e"
+module_global_includes = [ "<cstdint>" ]
+
+
+# ===========================================================================
+#
+# the module interface unit
+#
+# ===========================================================================
+
+def module_interface( header ):
+   header = header.replace( "constexpr auto ", "inline constexpr auto " )
+   header = re.sub(
+      r"#define (\w+) \( \( (\w+) \* \) (0x[0-9a-fA-F]+) \)",
+      r"inline constexpr hr::peripheral< \2, \3 > \1 = {};",
+      header )
+   s = ""
+   s += "module;\n"
+   for include in module_global_includes:
+      s += "#include %s\n" % include
+   s += "\n"
+   s += "export module %s;\n" % module_name
+   s += "\n"
+   s += "export {\n"
+   s += "\n"
+   s += header
+   s += "} // export\n"
+   return s
+
+
+# ===========================================================================
+#
+# main
+#
+# ===========================================================================
+
+# returns whether the source compiles, reports the errors when not
+def compile( directory, source ):
+   result = subprocess.run(
+      [ compiler ] + flags + [ "-I" + library ] + source,
+      cwd = directory, capture_output = True, text = True )
+   if result.returncode != 0:
+      print( result.stderr )
+   print( "%s: %s" % ( source[ -1 ], 
+      "ok" if result.returncode == 0 else "FAILED" ) )
+   return result.returncode == 0
+
+def main():
+   header = open( os.path.join( library, "header.hpp" ) ).read()
+   failures = 0
+   with tempfile.TemporaryDirectory() as directory:
+      open( os.path.join( directory, "chip.cppm" ), "w" ).write(
+         module_interface( header ) )
+      shutil.copy( os.path.join( here, "use.cpp" ), directory )
+      # use.cpp needs the compiled module interface
+      for source in [ [ "-x", "c++", "chip.cppm" ], [ "use.cpp" ] ]:
+         if not compile( directory, source ):
+            failures += 1
+            break
+   print( "module, %d failure(s)" % failures )
+   return 1 if failures > 0 else 0
+
+sys.exit( main() )
@@ -0,0 +1,54 @@
+// ==========================================================================
+//
+// uses of the chip module, compiled by module.py: each line is an 
+// operation that must compile when the registers are imported
+// from a module instead of included from a header
+//
+// ==========================================================================
+
+import chip.sam3x8e;
+
+void on_p3();
+
+// the properties and the access policy are the same as in a header
+static_assert( decltype( Pioa::ODSR )::direct );
+static_assert( decltype( Pioa::ODSR )::use_bit_band( 1 << 3 ) );
+static_assert( ! decltype( Pmc::PMC_SCER )::can_read );
+
+void pioa_set(){
+   PIOA->ODSR |= PIOA_ODSR_P< 3 >;
+}
+
+void pioa_clear(){
+   PIOA->ODSR &= ~ PIOA_ODSR_P< 3 >;
+}
+
+void pioa_fields(){
+   PIOA->ODSR |= PIOA_ODSR_P< 3 > | PIOA_ODSR_P< 5 >;
+}
+
+void pmc_write_only(){
+   PMC->PMC_SCER = PMC_SCER_UOTGCLK;
+}
+
+void pmc_update(){
+   PMC->PMC_MCKR <<= PMC_MCKR_CSS_PLLA_CLK;
+}
+
+bool pmc_ready(){
+   return ( PMC->PMC_SR.read() & PMC_SR_MCKRDY ) != 0;
+}
+
+void pmc_transaction(){
+   PMC->PMC_MCKR.transaction()
+      <<= PMC_MCKR_CSS_PLLA_CLK;
+}
+
+void pioa_irq(){
+   hr::nvic_enable< PIOA_IRQS >();
+   hr::nvic_priority< PIOA_IRQS, 3 >();
+}
+
+void pioa_handler(){
+   pioa_dispatch< hr::handler< PioaInterrupt::P3, on_p3 > >();
+}
@@ -9,6 +9,7 @@
 //
 // register &= ~ fields_mask
 // register |= fields_value
+// register |= fields_mask
 // register = ( register & ~ fields_mask ) | fields_value
 //
 // where 
@@ -20,8 +21,39 @@
 //   register that is accessed
 // - the bits 'covered' by the mask and value must agree
 //
+// register <<= fields_value + fields_value ...
+//
+// sets the fields to the (compile-time or run-time) values, in one
+// read-modify-write; the + requires the fields to be disjoint.
+// A fields_value for a run-time value is created by fields_mask( value ).
+//
+// register.read() returns a snapshot, from which any number of fields
+// can be extracted with only that one read of the register.
+//
+// Updates spread over several statements can be collected in a
+// register.transaction(), which commits them in one read-modify-write.
+//
+// hr::write_burst< &P::A, &P::B, ... >( peripheral, a, b, ... ) writes
+// full values to adjacent registers, with store-multiple instructions.
+// hr::write_block / read_block / write_fifo / read_fifo copy buffers 
+// to and from register arrays and data registers.
+//
+// hr::wait_until( register, fields_mask or fields_value, timeout ) 
+// polls until the fields have the value, or the timeout expires.
+//
+// hr::dispatch< key, hr::handler< key::FIELD, function >... >( pending )
+// calls the handlers of the pending interrupts of a peripheral.
+//
+// hr::make_vector_table< number_of_irqs >( stack, reset, default, 
+//    hr::bind( irq, handler )... ) builds the vector table at compile time.
+// hr::nvic_enable< irq_set >() and nvic_priority< irq_set, priority >() 
+// write the NVIC for a set of IRQs.
+//
 // ============================================================================
 
+#ifndef HARDWARE_REGISTERS_HPP
+#define HARDWARE_REGISTERS_HPP
+
 #include <cstdint>
 
 namespace hardware_registers {
@@ -49,6 +81,22 @@ constexpr register_value_type bit_mask(
 }
 
 
+// ============================================================================
+// the position of the lowest 1 bit in a (non-zero) mask
+// example: first_bit( 0b0'111'00 ) == 2
+// ============================================================================
+
+constexpr int first_bit( 
+   register_value_type mask 
+){
+   if( ( mask & 0b01 ) != 0 ){
+      return 0;
+   } else {
+      return 1 + first_bit( mask >> 1 );
+   }   
+}
+
+
 // ============================================================================
 // a field_mask
 // ============================================================================
@@ -62,13 +110,25 @@ struct field_mask {
    static constexpr int class_register_address  = _class_register_address;
    static constexpr register_value_type used     = _used;
    static constexpr register_value_type mask     = _mask;
+      __attribute__((always_inline))
    constexpr field_mask( int dummy = 0 ){}
 };
 
 
+template<
+   register_address_type  _class_register_address, 
+   register_value_type    _used
+>
+struct field_value;
+
+
 // ============================================================================
 // a field_mask literal
 // specified by start_bit and number_of_bits
+//
+// field_mask_literal( value ) is the field_value for a value that is 
+// only known at run-time, like the vendor FIELD( value ) macros:
+// the value is shifted to the field, and truncated to its width.
 // ============================================================================
 
 template< 
@@ -81,7 +141,14 @@ struct field_mask_literal : field_mask <
    bit_mask( _start_bit, _number_of_bits ),
    bit_mask( _start_bit, _number_of_bits )
 >{
+      __attribute__((always_inline))
    constexpr field_mask_literal( int dummy = 0 ){}
+
+      __attribute__((always_inline))
+   constexpr auto operator()( register_value_type value ) const {
+      return field_value< _class_register_address, field_mask_literal::mask >( 
+         ( value << _start_bit ) & field_mask_literal::mask );
+   }
 };
 
 
@@ -96,6 +163,8 @@ template<
    register_value_type    _right_used,
    register_value_type    _right_mask
 >
+   __attribute__((always_inline))
+   constexpr
 field_mask< 
    _class_register_address, 
    _left_used | _right_used,
@@ -121,6 +190,7 @@ struct inverted_field_mask {
    static constexpr int class_register_address  = _class_register_address;
    static constexpr register_value_type used     = _used;
    static constexpr register_value_type mask     = _mask;
+      __attribute__((always_inline))
    constexpr inverted_field_mask( int dummy = 0 ){}
 };
 
@@ -134,6 +204,8 @@ template<
    register_value_type    _used,
    register_value_type    _mask
 >
+   __attribute__((always_inline))
+   constexpr
 inverted_field_mask< 
    _class_register_address, 
    _used,
@@ -158,6 +230,7 @@ struct masked_register_value {
    static constexpr int class_register_address  = _class_register_address;
    static constexpr register_value_type used     = _used;
    static constexpr register_value_type mask     = _mask;
+      __attribute__((always_inline))
    constexpr masked_register_value( int dummy = 0 ){}
 };
 
@@ -176,8 +249,10 @@ struct field_value {
    
    const register_value_type value;
    
+      __attribute__((always_inline))
    constexpr field_value( register_value_type value ): value( value ){}
    
+      __attribute__((always_inline))
    constexpr operator uint32_t() const { return value; }
 };
 
@@ -196,6 +271,7 @@ struct field_value_literal : public field_value <
    _class_register_address, 
    bit_mask( _start_bit, _number_of_bits )
 >{
+      __attribute__((always_inline))
    constexpr field_value_literal( register_value_type right ): 
       field_value <
          _class_register_address, 
@@ -213,6 +289,8 @@ template<
    register_value_type    _left_used,
    register_value_type    _right_used
 >
+   __attribute__((always_inline))
+   constexpr
 field_value< 
    _class_register_address, 
    _left_used | _right_used
@@ -224,6 +302,33 @@ field_value<
 }   
 
 
+// ============================================================================
+// the operator + of two field_value values
+// 
+// Unlike operator |, this requires the fields to be disjoint:
+// the result is used with <<=, which writes exactly the used bits,
+// and overlapping fields would specify two values for the same bits.
+// ============================================================================
+
+template< 
+   register_address_type  _class_register_address, 
+   register_value_type    _left_used,
+   register_value_type    _right_used
+>
+   requires( ( _left_used & _right_used ) == 0 )
+   __attribute__((always_inline))
+   constexpr
+field_value< 
+   _class_register_address, 
+   _left_used | _right_used
+> operator + (
+   field_value< _class_register_address, _left_used > left,
+   field_value< _class_register_address, _right_used > right
+){
+   return ( left.value | right.value );
+}   
+
+
 // ============================================================================
 // an updated_register_value
 // specified by < start_bit, number_of_bits >( value )
@@ -237,6 +342,7 @@ template<
 struct updated_register_value {
    register_value_type or_value;
    
+      __attribute__((always_inline))
    constexpr updated_register_value( register_value_type value ): 
    or_value( value ){}
 };
@@ -251,6 +357,8 @@ template<
    register_value_type    _and_mask,
    register_value_type    _or_used
 >
+   __attribute__((always_inline))
+   constexpr
 updated_register_value< 
    _class_register_address, 
    _and_mask,
@@ -260,69 +368,186 @@ updated_register_value<
    field_value< _class_register_address, _or_used > right
 ){
    return right.value;
-}   
-
-
-
+}
 
 
 // ============================================================================
-// a hardware register
-// register &= operator
-// register |= operator
-// register = operator
+// a register snapshot
+//
+// A (non-volatile) copy of a register value, obtained by one read
+// of the register, that still carries the register it belongs to.
+// All fields are extracted from the same read, so they are 
+// consistent, even for a status register that changes underneath.
+//
+// auto mckr = PMC->PMC_MCKR.read();
+// if( ( mckr & PMC_MCKR_CSS_Msk ) == PMC_MCKR_CSS_PLLA_CLK ) ...
+// if( mckr == PMC_MCKR_PRES_CLK_3 ) ...
+// clock >>= mckr.read( PMC_MCKR_PRES_Msk );
+// clock >>= mckr.read< PMC_MCKR_PRES_Msk >();
 // ============================================================================
 
-         
 template<
-   register_address_type _class_register_address       
+   register_address_type _class_register_address
 >
-struct hardware_register {
-   
-   volatile register_value_type the_register;   
-   
+struct register_snapshot {
+
+   const register_value_type value;
+
+      __attribute__((always_inline))
+   constexpr register_snapshot( register_value_type value ): value( value ){}
+
    // =========================================================================
-   // operator & ( field_mask )
+   // operator & ( field_mask ) : the field bits, in place
    // =========================================================================
 
    template<
       register_value_type _used,
       register_value_type _mask
    >
-   register_value_type operator & (
+      __attribute__((always_inline))
+   constexpr register_value_type operator & (
       field_mask< _class_register_address, _used, _mask > rhs
    ) const {
-      return the_register & _mask;
-   }         
-   
+      return value & _mask;
+   }
+
    // =========================================================================
-   // operator & ( inverted_field_mask )
+   // operator == ( field_value ) : the fields have the value
    // =========================================================================
-   
-   template< 
-      register_value_type     _used,
-      register_value_type     _mask
+
+   template<
+      register_value_type _used
    >
-   masked_register_value< 
-      _class_register_address, 
-      _used,
-      _mask
-   > operator & (
-      inverted_field_mask< _class_register_address, _used, _mask > right
-   ){
-      return 0;
-   }      
-      
+      __attribute__((always_inline))
+   constexpr bool operator == (
+      field_value< _class_register_address, _used > rhs
+   ) const {
+      return ( value & _used ) == rhs.value;
+   }
+
    // =========================================================================
-   // operator = ( register_value_type )
+   // read( field_mask ) : the field value, shifted down to bit 0
    // =========================================================================
 
-   void operator = (
-      register_value_type rhs
-   ){
-      the_register = rhs;
-   }      
-   
+   template<
+      register_value_type _used,
+      register_value_type _mask
+   >
+      __attribute__((always_inline))
+   constexpr register_value_type read(
+      field_mask< _class_register_address, _used, _mask > rhs
+   ) const {
+      constexpr int shift = first_bit( _mask );
+      return ( value & _mask ) >> shift;
+   }
+
+   template< auto _field >
+      __attribute__((always_inline))
+   constexpr register_value_type read() const {
+      return read( _field );
+   }
+
+};
+
+
+// ============================================================================
+// memory ordering after a register write
+//
+// By default a write has no barrier. A write that must be complete
+// before what follows (a clock switch, disabling an interrupt before 
+// sleeping, ...) can be given an ordering tag:
+//
+// - no_barrier
+// - dmb       : memory accesses after it are not done before the write
+// - dsb       : no instruction after it executes before the write is done
+// - dsb_isb   : dsb, and the instruction pipeline is flushed
+//
+// PMC->PMC_MCKR.update( PMC_MCKR_CSS_MAIN_CLK, hr::dsb );
+//
+// On a host only the compiler is prevented from moving accesses.
+// ============================================================================
+
+enum class ordering {
+   none,
+   dmb,
+   dsb,
+   dsb_isb
+};
+
+template< ordering _ordering >
+struct ordering_tag {};
+
+inline constexpr ordering_tag< ordering::none >     no_barrier;
+inline constexpr ordering_tag< ordering::dmb >      dmb;
+inline constexpr ordering_tag< ordering::dsb >      dsb;
+inline constexpr ordering_tag< ordering::dsb_isb >  dsb_isb;
+
+template< ordering _ordering >
+   __attribute__((always_inline))
+inline void memory_barrier(){
+   if constexpr( _ordering != ordering::none ){
+      #ifdef __arm__
+         if constexpr( _ordering == ordering::dmb ){
+            asm volatile( "dmb" ::: "memory" );
+         } else if constexpr( _ordering == ordering::dsb ){
+            asm volatile( "dsb" ::: "memory" );
+         } else {
+            asm volatile( "dsb\n\tisb" ::: "memory" );
+         }
+      #else
+         asm volatile( "" ::: "memory" );
+      #endif
+   }
+}
+
+
+// ============================================================================
+// a register transaction
+//
+// Collects a number of updates of one register, and commits them
+// when the transaction goes out of scope (or when commit() is called)
+// in one read and one write, or in only one write when all writable
+// bits of the register are written.
+//
+// {
+//    auto t = PMC->PMC_MCKR.transaction();
+//    t &= ~ PMC_MCKR_CSS_Msk;
+//    t |= PMC_MCKR_CSS_MAIN_CLK;
+//    t &= ~ PMC_MCKR_PRES_Msk;
+// } // one read and one write of PMC_MCKR
+//
+// The masks and values are ordinary (non-volatile) members:
+// when the updates are compile-time constants the optimizer folds
+// them to the same code as a hand-written read-modify-write.
+//
+// The write is followed by the barrier for _ordering, as selected by
+// register.transaction( ordering_tag ).
+// ============================================================================
+
+template<
+   typename _register,
+   ordering _ordering = ordering::none
+>
+struct register_transaction {
+
+   static constexpr register_address_type class_register_address = 
+      _register::class_register_address;
+
+   _register & the_register;
+
+   // the bits that are written: cleared by &= and replaced by =
+   register_value_type written_mask;
+
+   // the value or-ed in after the written bits are cleared
+   register_value_type or_value;
+
+      __attribute__((always_inline))
+   register_transaction( _register & the_register ):
+      the_register( the_register ), written_mask( 0 ), or_value( 0 ){}
+
+   register_transaction( const register_transaction & ) = delete;
+   register_transaction & operator = ( const register_transaction & ) = delete;
+
    // =========================================================================
    // operator &= ( inverted_field_mask )
    // =========================================================================
@@ -331,12 +556,14 @@ struct hardware_register {
       register_value_type _used,
       register_value_type _mask
    >
+      __attribute__((always_inline))
    void operator &= (
-      inverted_field_mask< _class_register_address, _used, _mask > rhs
+      inverted_field_mask< class_register_address, _used, _mask > rhs
    ){
-      the_register = the_register & ~ _mask;
-   }      
-   
+      written_mask |= _mask;
+      or_value &= ~ _mask;
+   }
+
    // =========================================================================
    // operator |= ( field_value )
    // =========================================================================
@@ -344,11 +571,42 @@ struct hardware_register {
    template<
       register_value_type _used
    >
+      __attribute__((always_inline))
    void operator |= (
-      field_value< _class_register_address, _used > rhs
+      field_value< class_register_address, _used > rhs
    ){
-      the_register = the_register | rhs.value;
-   }      
+      or_value |= rhs.value;
+   }
+
+   // =========================================================================
+   // operator |= ( field_mask )
+   // =========================================================================
+
+   template<
+      register_value_type _used,
+      register_value_type _mask
+   >
+      __attribute__((always_inline))
+   void operator |= (
+      field_mask< class_register_address, _used, _mask > rhs
+   ){
+      or_value |= _mask;
+   }
+
+   // =========================================================================
+   // operator <<= ( field_value )
+   // =========================================================================
+
+   template<
+      register_value_type _used
+   >
+      __attribute__((always_inline))
+   void operator <<= (
+      field_value< class_register_address, _used > rhs
+   ){
+      written_mask |= _used;
+      or_value = ( or_value & ~ _used ) | rhs.value;
+   }
 
    // =========================================================================
    // operator = ( field_value )
@@ -357,12 +615,14 @@ struct hardware_register {
    template<
       register_value_type _used
    >
+      __attribute__((always_inline))
    void operator = (
-      field_value< _class_register_address, _used > rhs
+      field_value< class_register_address, _used > rhs
    ){
-      the_register = rhs.value;
-   }      
-   
+      written_mask = ~ 0;
+      or_value = rhs.value;
+   }
+
    // =========================================================================
    // operator = ( field_mask )
    // =========================================================================
@@ -371,49 +631,2013 @@ struct hardware_register {
       register_value_type _used,
       register_value_type _mask
    >
+      __attribute__((always_inline))
    void operator = (
-      field_mask< _class_register_address, _used, _mask > rhs
+      field_mask< class_register_address, _used, _mask > rhs
    ){
-      the_register = _mask;
-   }      
-   
+      written_mask = ~ 0;
+      or_value = _mask;
+   }
+
    // =========================================================================
-   // operator = ( updated_register_value )
+   // write the collected updates to the register
    // =========================================================================
 
-   template<
-      register_value_type _and_mask,
-      register_value_type _or_used
-   >
-   void operator = (
-      updated_register_value< _class_register_address, _and_mask, _or_used > rhs
-   ){
-      the_register = ( the_register & ~ _and_mask ) | rhs.or_value;
-   }      
-   
+      __attribute__((always_inline))
+   void commit(){
+      if( _register::covers_writable( written_mask ) ){
+         the_register = or_value;
+         memory_barrier< _ordering >();
+      } else if( ( written_mask | or_value ) != 0 ){
+         the_register.modify( written_mask, or_value );
+         memory_barrier< _ordering >();
+      }
+      written_mask = 0;
+      or_value = 0;
+   }
+
+      __attribute__((always_inline))
+   ~register_transaction(){
+      commit();
+   }
+
 };
 
 
 // ============================================================================
+// Cortex-M3/M4 bit-band
 //
-// used for filling reserved locations within a device
+// The first MB of SRAM and of the peripheral space have an alias region
+// in which each word maps to one bit. A write to the alias word sets or
+// clears that single bit as one (atomic) store, without a read.
 //
+// hardware_register uses this for single-bit updates when 
+// HARDWARE_REGISTERS_BIT_BAND is defined (the generated header does 
+// that for Cortex-M3 and M4 chips).
 // ============================================================================
 
-template<
-   register_address_type  _class_register_address,       
-   int                    _number_of_words      
->
-struct reserved {
-private:   
-   volatile register_value_type words[ _number_of_words ]; 
+   __attribute__((always_inline))
+constexpr bool in_bit_band_region( register_address_type address ){
+   return ( address >= 0x20000000 && address < 0x20100000 )
+      || ( address >= 0x40000000 && address < 0x40100000 );
+}
+
+   __attribute__((always_inline))
+constexpr register_address_type bit_band_alias( 
+   register_address_type address, 
+   int bit 
+){
+   return ( address & 0xF0000000 ) + 0x02000000 
+      + ( address & 0x000FFFFF ) * 32 + bit * 4;
+}
+
+static_assert( bit_band_alias( 0x40000000, 0 ) == 0x42000000 );
+static_assert( bit_band_alias( 0x400E0600, 3 ) == 0x43C0C00C );
+static_assert( bit_band_alias( 0x200FFFFC, 31 ) == 0x23FFFFFC );
+
+
+// ============================================================================
+// interrupt-safe read-modify-write
+//
+// A register that is updated by both the main code and an interrupt
+// handler can lose an update when the interrupt occurs between the 
+// read and the write of a read-modify-write. Per register type a 
+// concurrency other than none can be selected:
+//
+// - exclusive: the read-modify-write is done with LDREX / STREX,
+//   and retried when the STREX fails, which it does when an 
+//   interrupt occurred between the two (exception entry and exit 
+//   clear the exclusive monitor); interrupts are never disabled
+// - critical_section: interrupts are disabled (PRIMASK) during the
+//   read-modify-write, and restored afterwards
+//
+// On a host (or for testing the retry) a simulated exclusive monitor 
+// and interrupt control are used, or the ones selected by the
+// HARDWARE_REGISTERS_EXCLUSIVE_MONITOR and 
+// HARDWARE_REGISTERS_INTERRUPT_CONTROL macros.
+// ============================================================================
+
+enum class register_concurrency {
+   none,
+   exclusive,
+   critical_section
 };
 
-   
+// only for ARM: elsewhere the asm would not assemble, even when 
+// it is not used (a module emits these inline functions)
+#ifdef __arm__
+
+struct cortex_m_exclusive_monitor {
+
+      __attribute__((always_inline))
+   static inline register_value_type load( volatile register_value_type & r ){
+      register_value_type value;
+      asm volatile( "ldrex %0, [%1]" : "=r"( value ) : "r"( &r ) : "memory" );
+      return value;
+   }
+
+   // returns whether the store succeeded
+      __attribute__((always_inline))
+   static inline bool store( volatile register_value_type & r, register_value_type value ){
+      register_value_type failed;
+      asm volatile( "strex %0, %2, [%1]" 
+         : "=&r"( failed ) : "r"( &r ), "r"( value ) : "memory" );
+      return failed == 0;
+   }
+};
+
+struct cortex_m_interrupt_control {
+
+      __attribute__((always_inline))
+   static inline register_value_type disable(){
+      register_value_type primask;
+      asm volatile( "mrs %0, primask\n\tcpsid i" : "=r"( primask ) :: "memory" );
+      return primask;
+   }
+
+      __attribute__((always_inline))
+   static inline void restore( register_value_type primask ){
+      asm volatile( "msr primask, %0" :: "r"( primask ) : "memory" );
+   }
+};
+
+#endif // __arm__
+
+// the store fails as many times as there are pending 'interrupts',
+// and each time the (optional) interrupt handler is called, which
+// can for instance update the register
+struct simulated_exclusive_monitor {
+
+   static inline int interrupts = 0;
+
+   static inline void ( * interrupt )() = nullptr;
+
+      __attribute__((always_inline))
+   static inline register_value_type load( volatile register_value_type & r ){
+      return r;
+   }
+
+      __attribute__((always_inline))
+   static inline bool store( volatile register_value_type & r, register_value_type value ){
+      if( interrupts > 0 ){
+         --interrupts;
+         if( interrupt != nullptr ){
+            interrupt();
+         }
+         return false;
+      }
+      r = value;
+      return true;
+   }
+};
+
+struct simulated_interrupt_control {
+
+   static inline bool disabled = false;
+
+      __attribute__((always_inline))
+   static inline register_value_type disable(){
+      register_value_type was_disabled = disabled;
+      disabled = true;
+      return was_disabled;
+   }
+
+      __attribute__((always_inline))
+   static inline void restore( register_value_type was_disabled ){
+      disabled = was_disabled;
+   }
+};
+
+#ifndef HARDWARE_REGISTERS_EXCLUSIVE_MONITOR
+   #ifdef __arm__
+      #define HARDWARE_REGISTERS_EXCLUSIVE_MONITOR cortex_m_exclusive_monitor
+   #else
+      #define HARDWARE_REGISTERS_EXCLUSIVE_MONITOR simulated_exclusive_monitor
+   #endif
+#endif
+
+#ifndef HARDWARE_REGISTERS_INTERRUPT_CONTROL
+   #ifdef __arm__
+      #define HARDWARE_REGISTERS_INTERRUPT_CONTROL cortex_m_interrupt_control
+   #else
+      #define HARDWARE_REGISTERS_INTERRUPT_CONTROL simulated_interrupt_control
+   #endif
+#endif
+
+// register = ( register & ~ clear ) | set, retried until 
+// the store is not interrupted
+template< typename _monitor >
+   __attribute__((always_inline))
+inline void exclusive_modify( 
+   volatile register_value_type & r, 
+   register_value_type clear,
+   register_value_type set
+){
+   while( ! _monitor::store( r, ( _monitor::load( r ) & ~ clear ) | set ) ){}
+}
+
+// register = ( register & ~ clear ) | set, with interrupts disabled,
+// the read and the write are done via the access policy
+template< typename _interrupt_control, typename _access >
+   __attribute__((always_inline))
+inline void critical_section_modify( 
+   volatile register_value_type & r, 
+   register_value_type clear,
+   register_value_type set
+){
+   register_value_type saved = _interrupt_control::disable();
+   _access::store( r, ( _access::load( r ) & ~ clear ) | set );
+   _interrupt_control::restore( saved );
+}
+
+
 // ============================================================================
-// end of namespace hardware_registers
+// register access policies
+//
+// All reads and writes of a hardware_register are done by the 
+// load() and store() of its access policy, except that the exclusive
+// (LDREX / STREX) read-modify-write and the bit-band alias are only 
+// used with direct_access; with another policy those updates are 
+// a plain read-modify-write via the policy:
+//
+// - direct_access: volatile reads and writes (the default)
+// - relaxed_access: non-volatile reads and writes, which the compiler
+//   can combine or move, for instance out of a polling loop; call 
+//   barrier() where the order or the repetition matters
+// - traced_access: direct, and each access is reported to the
+//   (optional) trace function, for profiling and debugging
+// - simulated_access: nothing is accessed, each access is passed to the
+//   read and write functions of a simulation (on the host, where the
+//   peripherals don't exist)
+//
+// The policy is the third template parameter of hardware_register,
+// its default is HARDWARE_REGISTERS_ACCESS_POLICY, which is 
+// direct_access unless it is defined before this file is included.
 // ============================================================================
 
-}; 
+// The functions are declared inline: in a module a function that is
+// defined in its class is not inline, and can't be inlined elsewhere.
+
+struct direct_access {
+
+      __attribute__((always_inline))
+   static inline register_value_type load( const volatile register_value_type & r ){
+      return r;
+   }
+
+      __attribute__((always_inline))
+   static inline void store( volatile register_value_type & r, register_value_type value ){
+      r = value;
+   }
+};
+
+struct relaxed_access {
+
+      __attribute__((always_inline))
+   static inline register_value_type load( const volatile register_value_type & r ){
+      return const_cast< const register_value_type & >( r );
+   }
+
+      __attribute__((always_inline))
+   static inline void store( volatile register_value_type & r, register_value_type value ){
+      const_cast< register_value_type & >( r ) = value;
+   }
+
+   // the pending relaxed accesses are done before the ones after it
+      __attribute__((always_inline))
+   static inline void barrier(){
+      asm volatile( "" ::: "memory" );
+   }
+};
+
+struct traced_access {
+
+   static inline void ( * trace )( 
+      register_address_type  address, 
+      register_value_type    value, 
+      bool                   write 
+   ) = nullptr;
+
+      __attribute__((always_inline))
+   static inline register_value_type load( const volatile register_value_type & r ){
+      register_value_type value = r;
+      if( trace != nullptr ){
+         trace( (register_address_type)(uintptr_t) & r, value, false );
+      }
+      return value;
+   }
+
+      __attribute__((always_inline))
+   static inline void store( volatile register_value_type & r, register_value_type value ){
+      r = value;
+      if( trace != nullptr ){
+         trace( (register_address_type)(uintptr_t) & r, value, true );
+      }
+   }
+};
+
+struct simulated_access {
+
+   static inline register_value_type ( * read )( 
+      register_address_type address 
+   ) = nullptr;
+
+   static inline void ( * write )( 
+      register_address_type  address, 
+      register_value_type    value 
+   ) = nullptr;
+
+      __attribute__((always_inline))
+   static inline register_value_type load( const volatile register_value_type & r ){
+      return read( (register_address_type)(uintptr_t) & r );
+   }
 
+      __attribute__((always_inline))
+   static inline void store( volatile register_value_type & r, register_value_type value ){
+      write( (register_address_type)(uintptr_t) & r, value );
+   }
+};
+
+#ifndef HARDWARE_REGISTERS_ACCESS_POLICY
+   #define HARDWARE_REGISTERS_ACCESS_POLICY direct_access
+#endif
+
+// a builtin: in a GCC 12 module, a partial specialization of a 
+// variable template is not used by the importing translation units
+template< typename _a, typename _b >
+constexpr bool same_type = __is_same( _a, _b );
+
+
+// ============================================================================
+// the properties of a register, as specified in the SVD file
+//
+// A register that doesn't have the default properties is declared as
+// hardware_register< address, register_properties< access, ... > >
+//
+// The properties are scalar template parameters: a class type as a 
+// template parameter crashes GCC 12 when the register is used from 
+// a module.
+// ============================================================================
+
+enum class register_access {
+   read_write,
+   read_only,
+   write_only
+};
+
+// the effect of writing a bit (SVD modifiedWriteValues):
+// for the one_to_ and zero_to_ kinds only the bits that are written
+// as 1 (or 0) change, the other bits are not affected
+enum class modified_write {
+   modify,
+   one_to_clear,
+   one_to_set,
+   one_to_toggle,
+   zero_to_clear,
+   zero_to_set,
+   zero_to_toggle
+};
+
+// the side effect of reading a register (SVD readAction)
+enum class read_action {
+   none,
+   clear,
+   set,
+   modify,
+   modify_external
+};
+
+// reset_value is the value after a reset, for the bits set 
+// in reset_mask (the other bits have no known reset value);
+// by default no bit has a known reset value
+//
+// writable has the bits of the fields that can be written; the other
+// bits are reserved (or read-only) and are written as 0
+//
+// concurrency selects how a read-modify-write is protected against
+// interrupts (this one is not from the SVD file)
+template<
+   register_access      _access      = register_access::read_write,
+   register_value_type  _writable    = (register_value_type) ~ 0,
+   register_value_type  _reset_value = 0,
+   register_value_type  _reset_mask  = 0,
+   modified_write       _write       = modified_write::modify,
+   read_action          _read        = read_action::none,
+   register_concurrency _concurrency = register_concurrency::none
+>
+struct register_properties {
+   static constexpr register_access      access      = _access;
+   static constexpr register_value_type  writable    = _writable;
+   static constexpr register_value_type  reset_value = _reset_value;
+   static constexpr register_value_type  reset_mask  = _reset_mask;
+   static constexpr modified_write       write       = _write;
+   static constexpr read_action          read        = _read;
+   static constexpr register_concurrency concurrency = _concurrency;
+};
+
+
+// ============================================================================
+// a hardware register
+// register &= operator
+// register |= operator
+// register = operator
+//
+// The operations that are allowed depend on the properties:
+// - a read_only register can't be written
+// - a write_only register can't be read, hence it can only
+//   be written as a whole: no &=, |= or partial <<=
+// - for a one_to_ register, |= writes only the 1 bits of the value
+//   (a single store), for a zero_to_ register &= ~ writes only the 
+//   0 bits of the inverted mask; all other read-modify-writes are 
+//   rejected, because they would also act on the bits that happen 
+//   to read back as 1 (or 0)
+// - a register that has a read_action can only be read by read(),
+//   which reads it exactly once: the fields must be tested on the
+//   snapshot, and read-modify-writes are rejected. This holds for 
+//   all fields, also when only some fields have the read_action: 
+//   the bus reads the whole register, so a read for any field 
+//   triggers the action (for instance clears the clear-on-read 
+//   flags), and the value of those fields would be lost
+//
+// With HARDWARE_REGISTERS_BIT_BAND, |= and &= ~ of a single-bit 
+// field_mask, and <<= of a single-bit field_value, are done as one store
+// to the bit-band alias, for registers that allow a read-modify-write.
+//
+// initialize( fields_value ) is for a register that is known to still 
+// have its reset value, typically in cold-boot initialization: 
+// it writes the fields, and the reset value for all other bits, 
+// in a single store. All other bits must have a known reset value.
+// ============================================================================
+
+         
+template<
+   register_address_type _class_register_address,
+   typename              _properties = register_properties<>,
+   typename              _access = HARDWARE_REGISTERS_ACCESS_POLICY
+>
+struct hardware_register {
+   
+   volatile register_value_type the_register;   
+
+private:
+
+   // the transactions and the library functions of register_io
+   // use load(), store() and modify()
+   template< typename, ordering > friend struct register_transaction;
+   friend struct register_io;
+
+   // =========================================================================
+   // all reads and writes are done by these two, via the access policy
+   // =========================================================================
+
+      __attribute__((always_inline))
+   register_value_type load() const {
+      return _access::load( the_register );
+   }
+
+      __attribute__((always_inline))
+   void store( register_value_type value ){
+      _access::store( the_register, value );
+   }
+
+public:
+
+   static constexpr register_address_type class_register_address = 
+      _class_register_address;
+
+   using properties = _properties;
+
+   using access_policy = _access;
+
+   static constexpr bool direct = same_type< _access, direct_access >;
+
+   static constexpr bool can_read = 
+      _properties::access != register_access::write_only;
+
+   static constexpr bool can_write = 
+      _properties::access != register_access::read_only;
+
+   static constexpr bool read_has_effect = 
+      _properties::read != read_action::none;
+
+   static constexpr bool ones_act = 
+      _properties::write == modified_write::one_to_clear
+      || _properties::write == modified_write::one_to_set
+      || _properties::write == modified_write::one_to_toggle;
+
+   static constexpr bool zeros_act = 
+      _properties::write == modified_write::zero_to_clear
+      || _properties::write == modified_write::zero_to_set
+      || _properties::write == modified_write::zero_to_toggle;
+
+   // read-modify-write
+   static constexpr bool can_modify = can_read && can_write 
+      && ! ones_act && ! zeros_act && ! read_has_effect;
+
+   // an update of the mask bits writes all writable bits,
+   // so it needs no read
+      __attribute__((always_inline))
+   static constexpr bool covers_writable( register_value_type mask ){
+      return ( _properties::writable & ~ mask ) == 0;
+   }
+
+   // an update of the mask bits is done via the bit-band alias
+   static constexpr bool use_bit_band( register_value_type mask ){
+      #ifdef HARDWARE_REGISTERS_BIT_BAND
+         return direct && can_modify 
+            && mask != 0 && ( mask & ( mask - 1 ) ) == 0;
+      #else
+         return false;
+      #endif
+   }
+
+private:
+
+   // register = ( register & ~ clear ) | set: all read-modify-writes
+   // are done by this function, with the protection selected by 
+   // the concurrency property (exclusive only with direct_access)
+      __attribute__((always_inline))
+   void modify( register_value_type clear, register_value_type set ){
+      if constexpr( 
+         _properties::concurrency == register_concurrency::exclusive && direct
+      ){
+         exclusive_modify< HARDWARE_REGISTERS_EXCLUSIVE_MONITOR >( 
+            the_register, clear, set );
+      } else if constexpr( 
+         _properties::concurrency == register_concurrency::critical_section 
+      ){
+         critical_section_modify< HARDWARE_REGISTERS_INTERRUPT_CONTROL, _access >( 
+            the_register, clear, set );
+      } else {
+         store( ( load() & ~ clear ) | set );
+      }
+   }
+
+   // write the single bit of _mask, via the bit-band alias when the
+   // register is in a bit-band region (which is known at compile time 
+   // when the peripheral address is), otherwise by a read-modify-write
+   template< register_value_type _mask >
+      __attribute__((always_inline))
+   void bit_band_write( register_value_type bit_value ){
+      constexpr int bit = first_bit( _mask );
+      const register_address_type address = 
+         (register_address_type)(uintptr_t) & the_register;
+      if( in_bit_band_region( address ) ){
+         _access::store( 
+            * ( volatile register_value_type * )(uintptr_t) 
+               bit_band_alias( address, bit ), 
+            bit_value );
+      } else {
+         modify( _mask, bit_value << bit );
+      }
+   }
+
+public:
+   
+   // =========================================================================
+   // operator & ( field_mask )
+   // =========================================================================
+
+   template<
+      register_value_type _used,
+      register_value_type _mask
+   >
+      requires( can_read && ! read_has_effect )
+      __attribute__((always_inline))
+   register_value_type operator & (
+      field_mask< _class_register_address, _used, _mask > rhs
+   ) const {
+      return load() & _mask;
+   }         
+   
+   // =========================================================================
+   // read() : a snapshot of the register
+   // =========================================================================
+
+      __attribute__((always_inline))
+   register_snapshot< _class_register_address > read() const
+      requires can_read
+   {
+      return load();
+   }
+
+   // =========================================================================
+   // operator & ( inverted_field_mask )
+   // =========================================================================
+   
+   template< 
+      register_value_type     _used,
+      register_value_type     _mask
+   >
+      requires can_modify
+      __attribute__((always_inline))
+   masked_register_value< 
+      _class_register_address, 
+      _used,
+      _mask
+   > operator & (
+      inverted_field_mask< _class_register_address, _used, _mask > right
+   ){
+      return 0;
+   }      
+      
+   // =========================================================================
+   // operator = ( register_value_type )
+   // =========================================================================
+
+      __attribute__((always_inline))
+   void operator = (
+      register_value_type rhs
+   )
+      requires can_write
+   {
+      store( rhs );
+   }      
+   
+   // =========================================================================
+   // operator &= ( inverted_field_mask )
+   // =========================================================================
+
+   template<
+      register_value_type _used,
+      register_value_type _mask
+   >
+      requires( can_modify || ( can_write && zeros_act ) )
+      __attribute__((always_inline))
+   void operator &= (
+      inverted_field_mask< _class_register_address, _used, _mask > rhs
+   ){
+      if constexpr( zeros_act ){
+         store( _properties::writable & ~ _mask );
+      } else if constexpr( use_bit_band( _mask ) ){
+         bit_band_write< _mask >( 0 );
+      } else {
+         modify( _mask, 0 );
+      }
+   }      
+   
+   // =========================================================================
+   // operator |= ( field_value )
+   // =========================================================================
+
+   template<
+      register_value_type _used
+   >
+      requires( can_modify || ( can_write && ones_act ) )
+      __attribute__((always_inline))
+   void operator |= (
+      field_value< _class_register_address, _used > rhs
+   ){
+      if constexpr( ones_act ){
+         store( rhs.value );
+      } else {
+         modify( 0, rhs.value );
+      }
+   }      
+
+   // =========================================================================
+   // operator |= ( field_mask )
+   // =========================================================================
+
+   template<
+      register_value_type _used,
+      register_value_type _mask
+   >
+      requires( can_modify || ( can_write && ones_act ) )
+      __attribute__((always_inline))
+   void operator |= (
+      field_mask< _class_register_address, _used, _mask > rhs
+   ){
+      if constexpr( ones_act ){
+         store( _mask );
+      } else if constexpr( use_bit_band( _mask ) ){
+         bit_band_write< _mask >( 1 );
+      } else {
+         modify( 0, _mask );
+      }
+   }      
+
+   // =========================================================================
+   // operator = ( field_value )
+   // =========================================================================
+
+   template<
+      register_value_type _used
+   >
+      requires can_write
+      __attribute__((always_inline))
+   void operator = (
+      field_value< _class_register_address, _used > rhs
+   ){
+      store( rhs.value );
+   }      
+   
+   // =========================================================================
+   // operator = ( field_mask )
+   // =========================================================================
+
+   template<
+      register_value_type _used,
+      register_value_type _mask
+   >
+      requires can_write
+      __attribute__((always_inline))
+   void operator = (
+      field_mask< _class_register_address, _used, _mask > rhs
+   ){
+      store( _mask );
+   }      
+   
+   // =========================================================================
+   // operator = ( updated_register_value )
+   // =========================================================================
+
+   template<
+      register_value_type _and_mask,
+      register_value_type _or_used
+   >
+      requires can_modify
+      __attribute__((always_inline))
+   void operator = (
+      updated_register_value< _class_register_address, _and_mask, _or_used > rhs
+   ){
+      if constexpr( covers_writable( _and_mask ) ){
+         store( rhs.or_value );
+      } else {
+         modify( _and_mask, rhs.or_value );
+      }
+   }
+
+   // =========================================================================
+   // operator <<= ( field_value )
+   //
+   // Sets the fields used by the value, and leaves the other bits 
+   // unchanged, in one read-modify-write. When the value covers
+   // all writable bits of the register it is written without the read.
+   // =========================================================================
+
+   template<
+      register_value_type _used
+   >
+      requires( can_modify || ( can_write && covers_writable( _used ) ) )
+      __attribute__((always_inline))
+   void operator <<= (
+      field_value< _class_register_address, _used > rhs
+   ){
+      if constexpr( covers_writable( _used ) ){
+         store( rhs.value );
+      } else if constexpr( use_bit_band( _used ) ){
+         constexpr int bit = first_bit( _used );
+         bit_band_write< _used >( rhs.value >> bit );
+      } else {
+         modify( _used, rhs.value );
+      }
+   }
+
+   // =========================================================================
+   // initialize( field_value )
+   // =========================================================================
+
+   template<
+      register_value_type _used
+   >
+      requires( 
+         can_write
+         && _properties::write == modified_write::modify
+         && ( ~ _used & ~ _properties::reset_mask ) == 0 
+      )
+      __attribute__((always_inline))
+   void initialize(
+      field_value< _class_register_address, _used > rhs
+   ){
+      store( ( _properties::reset_value & ~ _used ) | rhs.value );
+   }
+
+   // =========================================================================
+   // initialize( field_mask ) : the bits of the mask set to 1
+   // =========================================================================
+
+   template<
+      register_value_type _used,
+      register_value_type _mask
+   >
+      requires( 
+         can_write
+         && _properties::write == modified_write::modify
+         && ( ~ _used & ~ _properties::reset_mask ) == 0 
+      )
+      __attribute__((always_inline))
+   void initialize(
+      field_mask< _class_register_address, _used, _mask > rhs
+   ){
+      store( _properties::reset_value | _mask );
+   }
+
+   // =========================================================================
+   // start a transaction
+   // =========================================================================
+
+   template< ordering _ordering = ordering::none >
+      requires can_modify
+      __attribute__((always_inline))
+   register_transaction< hardware_register, _ordering > transaction( 
+      ordering_tag< _ordering > = {} 
+   ){
+      return *this;
+   }
+
+   // =========================================================================
+   // write( value, ordering_tag ) : register = value, and a barrier
+   // =========================================================================
+
+   template< ordering _ordering = ordering::none >
+      requires can_write
+      __attribute__((always_inline))
+   void write( 
+      register_value_type value, 
+      ordering_tag< _ordering > = {} 
+   ){
+      store( value );
+      memory_barrier< _ordering >();
+   }
+
+   template< 
+      register_value_type _used,
+      ordering            _ordering = ordering::none 
+   >
+      requires can_write
+      __attribute__((always_inline))
+   void write( 
+      field_value< _class_register_address, _used > value, 
+      ordering_tag< _ordering > = {} 
+   ){
+      store( value.value );
+      memory_barrier< _ordering >();
+   }
+
+   template< 
+      register_value_type _used,
+      register_value_type _mask,
+      ordering            _ordering = ordering::none 
+   >
+      requires can_write
+      __attribute__((always_inline))
+   void write( 
+      field_mask< _class_register_address, _used, _mask > value, 
+      ordering_tag< _ordering > = {} 
+   ){
+      store( _mask );
+      memory_barrier< _ordering >();
+   }
+
+   // =========================================================================
+   // update( value, ordering_tag ) : register <<= value, and a barrier
+   // =========================================================================
+
+   template< 
+      register_value_type _used,
+      ordering            _ordering = ordering::none 
+   >
+      requires( can_modify || ( can_write && covers_writable( _used ) ) )
+      __attribute__((always_inline))
+   void update( 
+      field_value< _class_register_address, _used > value, 
+      ordering_tag< _ordering > = {} 
+   ){
+      *this <<= value;
+      memory_barrier< _ordering >();
+   }
+
+};
+
+
+// ============================================================================
+//
+// the register reads and writes of the library functions that are not
+// operators (bursts, blocks, waits): via the access policy, and only
+// when the register can be read or written
+//
+// ============================================================================
+
+struct register_io {
+
+   template< typename _register >
+      requires _register::can_read
+      __attribute__((always_inline))
+   static register_value_type load( const _register & r ){
+      return r.load();
+   }
+
+   template< typename _register >
+      requires _register::can_write
+      __attribute__((always_inline))
+   static void store( _register & r, register_value_type value ){
+      r.store( value );
+   }
+};
+
+
+// ============================================================================
+//
+// used for filling reserved locations within a device
+//
+// ============================================================================
+
+template<
+   register_address_type  _class_register_address,       
+   int                    _number_of_words      
+>
+struct reserved {
+private:   
+   volatile register_value_type words[ _number_of_words ];
+};
+
+
+// ============================================================================
+//
+// a peripheral (struct of registers) located at _address
+//
+// This is a work-alike for the #define PERIPHERAL ( ( type * ) address )
+// trick, for where a macro can't be used (like in a module).
+// The object is constexpr, so (unlike placement new) it doesn't
+// create a global constructor call.
+//
+// ============================================================================
+
+template<
+   typename               _peripheral_type,
+   register_address_type  _address
+>
+struct peripheral {
+   static constexpr register_address_type address = _address;
+
+      __attribute__((always_inline))
+   _peripheral_type * operator->() const {
+      return ( _peripheral_type * ) _address;
+   }
+
+      __attribute__((always_inline))
+   _peripheral_type & operator*() const {
+      return * ( _peripheral_type * ) _address;
+   }
+};
+
+
+// ============================================================================
+//
+// a burst write of consecutive registers of one peripheral
+//
+// hr::write_burst< &Usart0::BRGR, &Usart0::RTOR, &Usart0::TTGR >( 
+//    USART0, brgr, rtor, ttgr );
+//
+// writes full values to a run of registers. The registers must be
+// members of the same peripheral struct, writable, and adjacent in
+// the struct layout (a reserved gap between them is an error).
+// On ARM the run is written with store-multiple (stm) instructions
+// of up to 4 registers each, instead of one str per register.
+// The stores are done in address order.
+//
+// When a register has another access policy than direct_access the
+// registers are written one by one via that policy.
+//
+// ============================================================================
+
+template< typename _member_pointer >
+struct member_pointer_traits;
+
+template< typename _register, typename _peripheral >
+struct member_pointer_traits< _register _peripheral::* > {
+   using register_type = _register;
+   using peripheral_type = _peripheral;
+};
+
+template< auto _member >
+using member_register = 
+   typename member_pointer_traits< decltype( _member ) >::register_type;
+
+template< auto _member >
+using member_peripheral = 
+   typename member_pointer_traits< decltype( _member ) >::peripheral_type;
+
+// a value for each register of a burst
+template< auto _member >
+using burst_value = register_value_type;
+
+template< auto _first, auto... _next >
+constexpr bool burst_is_valid(){
+   register_address_type address = 
+      member_register< _first >::class_register_address;
+   bool valid = member_register< _first >::can_write;
+   ( ( valid = valid 
+      && same_type< member_peripheral< _next >, member_peripheral< _first > >
+      && member_register< _next >::can_write
+      && member_register< _next >::class_register_address == ( address += 4 ) 
+   ), ... );
+   return valid;
+}
+
+template< int _n >
+   __attribute__((always_inline))
+inline void store_multiple( 
+   volatile register_value_type * address, 
+   const register_value_type * values 
+){
+   if constexpr( _n == 0 ){
+      return;
+   } else {
+      #ifdef __arm__
+         register register_value_type r0 asm( "r0" ) = values[ 0 ];
+         if constexpr( _n == 1 ){
+            asm volatile( "str r0, [%0]" :: "r"( address ), "r"( r0 ) : "memory" );
+         } else {
+            register register_value_type r1 asm( "r1" ) = values[ 1 ];
+            if constexpr( _n == 2 ){
+               asm volatile( "stmia %0, {r0, r1}" 
+                  :: "r"( address ), "r"( r0 ), "r"( r1 ) : "memory" );
+            } else {
+               register register_value_type r2 asm( "r2" ) = values[ 2 ];
+               if constexpr( _n == 3 ){
+                  asm volatile( "stmia %0, {r0, r1, r2}" 
+                     :: "r"( address ), "r"( r0 ), "r"( r1 ), "r"( r2 ) 
+                     : "memory" );
+               } else {
+                  register register_value_type r3 asm( "r3" ) = values[ 3 ];
+                  asm volatile( "stmia %0!, {r0, r1, r2, r3}" 
+                     : "+r"( address ) 
+                     : "r"( r0 ), "r"( r1 ), "r"( r2 ), "r"( r3 ) 
+                     : "memory" );
+                  store_multiple< _n - 4 >( address, values + 4 );
+               }
+            }
+         }
+      #else
+         * address = values[ 0 ];
+         store_multiple< _n - 1 >( address + 1, values + 1 );
+      #endif
+   }
+}
+
+template< auto _first, auto... _next, typename _peripheral_pointer >
+   requires( burst_is_valid< _first, _next... >() )
+   __attribute__((always_inline))
+inline void write_burst( 
+   _peripheral_pointer     peripheral,
+   register_value_type     first_value,
+   burst_value< _next >... next_values
+){
+   member_peripheral< _first > & p = * peripheral;
+   if constexpr( 
+      member_register< _first >::direct && ( member_register< _next >::direct && ... )
+   ){
+      const register_value_type values[] = { first_value, next_values... };
+      store_multiple< 1 + sizeof...( _next ) >( 
+         & ( p.*_first ).the_register, values );
+   } else {
+      register_io::store( p.*_first, first_value );
+      ( register_io::store( p.*_next, next_values ), ... );
+   }
+}
+
+
+// ============================================================================
+//
+// block transfers between word buffers and registers
+//
+// hr::write_block( HSMCI->FIFO, buffer, count );
+// hr::read_block( HSMCI->FIFO, buffer, count );
+//
+// copy count words between a buffer and a register array (the
+// default count is the whole array, a larger count is limited to it), 
+//
+// hr::write_fifo( HSMCI->TDR, buffer, count );
+// hr::read_fifo( HSMCI->RDR, buffer, count );
+//
+// copy count words between a buffer and one (FIFO) data register.
+//
+// The copy is unrolled to chunks of 4 words. On ARM a chunk of a
+// register array is a single ldm/stm, a chunk of a buffer too.
+// Registers that have another access policy than direct_access are 
+// accessed one word at a time via that policy.
+//
+// ============================================================================
+
+template< int _n >
+   __attribute__((always_inline))
+inline void load_multiple( 
+   const volatile register_value_type * address, 
+   register_value_type * values 
+){
+   #ifdef __arm__
+      if constexpr( _n == 4 ){
+         register register_value_type r0 asm( "r0" );
+         register register_value_type r1 asm( "r1" );
+         register register_value_type r2 asm( "r2" );
+         register register_value_type r3 asm( "r3" );
+         asm volatile( "ldmia %4!, {r0, r1, r2, r3}" 
+            : "=r"( r0 ), "=r"( r1 ), "=r"( r2 ), "=r"( r3 ), "+r"( address ) 
+            :: "memory" );
+         values[ 0 ] = r0;
+         values[ 1 ] = r1;
+         values[ 2 ] = r2;
+         values[ 3 ] = r3;
+         return;
+      }
+   #endif
+   if constexpr( _n > 0 ){
+      values[ 0 ] = address[ 0 ];
+      load_multiple< _n - 1 >( address + 1, values + 1 );
+   }
+}
+
+// a block transfer stays within the register array
+template< int _n >
+   __attribute__((always_inline))
+constexpr int block_count( int count ){
+   return count > _n ? _n : count;
+}
+
+template< typename _register, int _n >
+   requires _register::can_write
+   __attribute__((always_inline))
+inline void write_block( 
+   _register ( & registers )[ _n ], 
+   const register_value_type * buffer, 
+   int count = _n 
+){
+   count = block_count< _n >( count );
+   if constexpr( _register::direct ){
+      volatile register_value_type * address = & registers[ 0 ].the_register;
+      for( ; count >= 4; count -= 4, address += 4, buffer += 4 ){
+         store_multiple< 4 >( address, buffer );
+      }
+      for( ; count > 0; --count ){
+         * address++ = * buffer++;
+      }
+   } else {
+      for( int i = 0; i < count; ++i ){
+         register_io::store( registers[ i ], buffer[ i ] );
+      }
+   }
+}
+
+template< typename _register, int _n >
+   requires _register::can_read
+   __attribute__((always_inline))
+inline void read_block( 
+   _register ( & registers )[ _n ], 
+   register_value_type * buffer, 
+   int count = _n 
+){
+   count = block_count< _n >( count );
+   if constexpr( _register::direct ){
+      const volatile register_value_type * address = 
+         & registers[ 0 ].the_register;
+      for( ; count >= 4; count -= 4, address += 4, buffer += 4 ){
+         load_multiple< 4 >( address, buffer );
+      }
+      for( ; count > 0; --count ){
+         * buffer++ = * address++;
+      }
+   } else {
+      for( int i = 0; i < count; ++i ){
+         buffer[ i ] = register_io::load( registers[ i ] );
+      }
+   }
+}
+
+template< typename _register >
+   requires _register::can_write
+   __attribute__((always_inline))
+inline void write_fifo( 
+   _register & fifo, 
+   const register_value_type * buffer, 
+   int count 
+){
+   for( ; count >= 4; count -= 4, buffer += 4 ){
+      register_value_type values[ 4 ];
+      load_multiple< 4 >( buffer, values );
+      register_io::store( fifo, values[ 0 ] );
+      register_io::store( fifo, values[ 1 ] );
+      register_io::store( fifo, values[ 2 ] );
+      register_io::store( fifo, values[ 3 ] );
+   }
+   for( ; count > 0; --count ){
+      register_io::store( fifo, * buffer++ );
+   }
+}
+
+template< typename _register >
+   requires _register::can_read
+   __attribute__((always_inline))
+inline void read_fifo( 
+   _register & fifo, 
+   register_value_type * buffer, 
+   int count 
+){
+   for( ; count >= 4; count -= 4, buffer += 4 ){
+      const register_value_type values[ 4 ] = { 
+         register_io::load( fifo ), register_io::load( fifo ), 
+         register_io::load( fifo ), register_io::load( fifo ) };
+      store_multiple< 4 >( buffer, values );
+   }
+   for( ; count > 0; --count ){
+      * buffer++ = register_io::load( fifo );
+   }
+}
+
+
+// ============================================================================
+//
+// wait until fields of a register have a value, with a timeout
+//
+// auto waited = hr::wait_until( PMC->PMC_SR, PMC_SR_MCKRDY );
+// auto waited = hr::wait_until( PMC->PMC_SR, PMC_SR_MCKRDY( 0 ) );
+// if( ! hr::wait_until( PMC->PMC_SR, PMC_SR_LOCKA, 100'000 ) ){ ... }
+// auto waited = hr::wait_until( PMC->PMC_SR, PMC_SR_MCKRDY, hr::wfe );
+//
+// waits until all bits of a field_mask are set, or until the fields
+// of a field_value have that value. The register is polled with one
+// read per iteration.
+//
+// A register that has a read_action (in any of its fields) is 
+// rejected: each poll would trigger the action, and the polls that
+// don't end the wait would discard the fields it affects. Such a 
+// register is polled with read(), testing each snapshot.
+//
+// The optional timeout is in cycles of the cycle counter, 0 (the 
+// default) is no timeout. The result converts to false when the
+// wait timed out; its .cycles is the number of cycles waited, 
+// for profiling (long) waits.
+//
+// With hr::wfe the core sleeps (wfe) between polls, which saves 
+// power, but only returns to poll at an event. So this is only for a 
+// flag that also generates an event, like an enabled interrupt 
+// (with SCB->SCR SEVONPEND when it is masked). Such a wait has no
+// timeout: a sleeping core would not notice it.
+//
+// The cycle counter is 
+// - on a Cortex-M3/M4/M7: the DWT CYCCNT, which is enabled (and on
+//   a Cortex-M7 first unlocked) by the wait
+// - otherwise a poll counter: each poll counts as one cycle
+// or the one selected by the HARDWARE_REGISTERS_CYCLE_COUNTER macro.
+// ============================================================================
+
+struct cortex_m_cycle_counter {
+
+   // DEMCR.TRCENA, DWT_CTRL.CYCCNTENA, DWT_CYCCNT
+   static constexpr uintptr_t demcr = 0xE000EDFC;
+   static constexpr uintptr_t dwt_ctrl = 0xE0001000;
+   static constexpr uintptr_t dwt_cyccnt = 0xE0001004;
+
+   // DWT_LAR: on a Cortex-M7 the DWT ignores writes until this key 
+   // is written, on a Cortex-M3/M4 the write is ignored
+   static constexpr uintptr_t dwt_lar = 0xE0001FB0;
+   static constexpr register_value_type dwt_lar_key = 0xC5ACCE55;
+
+      __attribute__((always_inline))
+   static inline register_value_type start(){
+      volatile register_value_type & trace = 
+         * ( volatile register_value_type * ) demcr;
+      volatile register_value_type & lock = 
+         * ( volatile register_value_type * ) dwt_lar;
+      volatile register_value_type & control = 
+         * ( volatile register_value_type * ) dwt_ctrl;
+      trace = trace | ( 1 << 24 );
+      lock = dwt_lar_key;
+      control = control | ( 1 << 0 );
+      return now();
+   }
+
+      __attribute__((always_inline))
+   static inline register_value_type now(){
+      return * ( volatile register_value_type * ) dwt_cyccnt;
+   }
+
+      __attribute__((always_inline))
+   static inline void poll(){}
+};
+
+struct poll_counter {
+
+   static inline register_value_type polls = 0;
+
+      __attribute__((always_inline))
+   static inline register_value_type start(){
+      return polls;
+   }
+
+      __attribute__((always_inline))
+   static inline register_value_type now(){
+      return polls;
+   }
+
+      __attribute__((always_inline))
+   static inline void poll(){
+      ++polls;
+   }
+};
+
+#ifndef HARDWARE_REGISTERS_CYCLE_COUNTER
+   #if defined( __ARM_ARCH_7M__ ) || defined( __ARM_ARCH_7EM__ )
+      #define HARDWARE_REGISTERS_CYCLE_COUNTER cortex_m_cycle_counter
+   #else
+      #define HARDWARE_REGISTERS_CYCLE_COUNTER poll_counter
+   #endif
+#endif
+
+enum class wait_mode {
+   spin,
+   wfe
+};
+
+template< wait_mode _mode >
+struct wait_tag {};
+
+inline constexpr wait_tag< wait_mode::spin >  spin;
+inline constexpr wait_tag< wait_mode::wfe >   wfe;
+
+struct wait_result {
+   bool                 reached;
+   register_value_type  cycles;
+
+      __attribute__((always_inline))
+   constexpr explicit operator bool() const {
+      return reached;
+   }
+};
+
+// ( register & mask ) == value, with a timeout in cycles (0 is none),
+// with wait_mode::wfe without a timeout: the core sleeps until an
+// event, so it would not notice the timeout
+template< 
+   typename _register, 
+   wait_mode _mode, 
+   typename _counter = HARDWARE_REGISTERS_CYCLE_COUNTER 
+>
+   requires( _register::can_read && ! _register::read_has_effect )
+   __attribute__((always_inline))
+inline wait_result wait_until_masked( 
+   _register & the_register,
+   register_value_type mask,
+   register_value_type value,
+   register_value_type timeout
+){
+   const register_value_type start = _counter::start();
+   bool reached = true;
+   if constexpr( _mode == wait_mode::wfe ){
+      while( ( register_io::load( the_register ) & mask ) != value ){
+         _counter::poll();
+         #ifdef __arm__
+            asm volatile( "wfe" ::: "memory" );
+         #endif
+      }
+   } else if( timeout == 0 ){
+      while( ( register_io::load( the_register ) & mask ) != value ){
+         _counter::poll();
+      }
+   } else {
+      while( ( register_io::load( the_register ) & mask ) != value ){
+         _counter::poll();
+         if( _counter::now() - start >= timeout ){
+            reached = false;
+            break;
+         }
+      }
+   }
+   return wait_result{ reached, _counter::now() - start };
+}
+
+template< 
+   typename            _register,
+   register_value_type _used,
+   register_value_type _mask
+>
+   __attribute__((always_inline))
+inline wait_result wait_until( 
+   _register & the_register,
+   field_mask< _register::class_register_address, _used, _mask > mask,
+   register_value_type timeout = 0,
+   wait_tag< wait_mode::spin > = {}
+){
+   return wait_until_masked< _register, wait_mode::spin >( 
+      the_register, _mask, _mask, timeout );
+}
+
+template< 
+   typename            _register,
+   register_value_type _used
+>
+   __attribute__((always_inline))
+inline wait_result wait_until( 
+   _register & the_register,
+   field_value< _register::class_register_address, _used > value,
+   register_value_type timeout = 0,
+   wait_tag< wait_mode::spin > = {}
+){
+   return wait_until_masked< _register, wait_mode::spin >( 
+      the_register, _used, value.value, timeout );
+}
+
+// with hr::wfe there is no timeout
+template< 
+   typename            _register,
+   register_value_type _used,
+   register_value_type _mask
+>
+   __attribute__((always_inline))
+inline wait_result wait_until( 
+   _register & the_register,
+   field_mask< _register::class_register_address, _used, _mask > mask,
+   wait_tag< wait_mode::wfe >
+){
+   return wait_until_masked< _register, wait_mode::wfe >( 
+      the_register, _mask, _mask, 0 );
+}
+
+template< 
+   typename            _register,
+   register_value_type _used
+>
+   __attribute__((always_inline))
+inline wait_result wait_until( 
+   _register & the_register,
+   field_value< _register::class_register_address, _used > value,
+   wait_tag< wait_mode::wfe >
+){
+   return wait_until_masked< _register, wait_mode::wfe >( 
+      the_register, _used, value.value, 0 );
+}
+
+
+// ============================================================================
+//
+// dispatch of the pending interrupts of a peripheral
+//
+// For a peripheral with an interrupt status register and an interrupt
+// mask register the generator emits an enum of the status fields 
+// (their bit numbers), and a dispatcher:
+//
+// void PMC_Handler(){
+//    pmc_dispatch< 
+//       hr::handler< PmcInterrupt::MCKRDY, on_ready >,
+//       hr::handler< PmcInterrupt::LOCKA, on_lock > >();
+// }
+//
+// The dispatcher reads the status and the mask register once, and
+// calls the handler of each pending bit, highest bit first, via a
+// constexpr table. Pending bits without a handler are ignored.
+// ============================================================================
+
+using interrupt_handler = void (*)();
+
+template< auto _bit, interrupt_handler _handler >
+struct handler {
+   using key = decltype( _bit );
+   static constexpr int bit = static_cast< int >( _bit );
+   static constexpr interrupt_handler function = _handler;
+};
+
+struct interrupt_table {
+   interrupt_handler handlers[ 32 ] = {};
+};
+
+template< typename... _handlers >
+constexpr interrupt_table make_interrupt_table(){
+   interrupt_table table;
+   ( ( table.handlers[ _handlers::bit ] = _handlers::function ), ... );
+   return table;
+}
+
+// each bit has at most one handler
+template< typename... _handlers >
+constexpr bool distinct_bits(){
+   register_value_type bits = 0;
+   bool distinct = true;
+   ( ( distinct = distinct && ( bits & ( 1u << _handlers::bit ) ) == 0,
+       bits |= 1u << _handlers::bit ), ... );
+   return distinct;
+}
+
+template< typename _key, typename... _handlers >
+   requires( 
+      ( same_type< typename _handlers::key, _key > && ... ) 
+      && distinct_bits< _handlers... >() )
+   __attribute__((always_inline))
+inline void dispatch( register_value_type pending ){
+   static constexpr interrupt_table table = 
+      make_interrupt_table< _handlers... >();
+   constexpr register_value_type bound = 
+      ( ( 1u << _handlers::bit ) | ... | 0u );
+   pending &= bound;
+   while( pending != 0 ){
+      const int bit = 31 - __builtin_clz( pending );
+      pending &= ~ ( 1u << bit );
+      table.handlers[ bit ]();
+   }
+}
+
+
+// ============================================================================
+//
+// a constexpr interrupt vector table
+//
+// The generator emits an Irq enum (the IRQ numbers, and the negative
+// numbers of the Cortex-M exceptions) and number_of_irqs. The vector 
+// table is built at compile time, with the handlers bound by IRQ:
+//
+// __attribute__((section( ".isr_vector" ), used))
+// constexpr auto vectors = hr::make_vector_table< number_of_irqs >(
+//    &__stack_end, reset_handler, default_handler,
+//    hr::bind( Irq::SysTick_IRQn, systick_handler ),
+//    hr::bind( Irq::UART_IRQn, uart_handler ) );
+//
+// All vectors without a binding get the default handler, except the
+// reserved ones. Binding an IRQ twice is a compile-time error.
+//
+// ============================================================================
+
+struct vector_binding {
+   int                irq;
+   interrupt_handler  handler;
+};
+
+// the IRQ is an enumerator (of the generated Irq), not a plain int
+template< typename _irq >
+   requires __is_enum( _irq )
+   __attribute__((always_inline))
+constexpr vector_binding bind( _irq irq, interrupt_handler handler ){
+   return vector_binding{ static_cast< int >( irq ), handler };
+}
+
+// the Cortex-M exceptions are IRQ -15 (reset) .. -1 (SysTick)
+template< int _number_of_irqs >
+struct vector_table {
+   const void *       stack;
+   interrupt_handler  vectors[ 15 + _number_of_irqs ];
+};
+
+// not constexpr: called (in a constant expression) when an IRQ
+// is bound twice, which makes that a compile-time error
+void vector_bound_twice();
+
+template< int _number_of_irqs, typename... _bindings >
+constexpr vector_table< _number_of_irqs > make_vector_table(
+   const void *       stack,
+   interrupt_handler  reset,
+   interrupt_handler  unbound,
+   _bindings...       bindings
+){
+   vector_table< _number_of_irqs > table = { stack, {} };
+   bool bound[ 15 + _number_of_irqs ] = {};
+   table.vectors[ 0 ] = reset;
+   for( int i = 1; i < 15 + _number_of_irqs; ++i ){
+      // -9 .. -6 and -3 are reserved
+      const int irq = i - 15;
+      if( ! ( ( irq >= -9 && irq <= -6 ) || irq == -3 ) ){
+         table.vectors[ i ] = unbound;
+      }
+   }
+   ( ( bound[ 15 + bindings.irq ] ? vector_bound_twice() : void(),
+       bound[ 15 + bindings.irq ] = true,
+       table.vectors[ 15 + bindings.irq ] = bindings.handler ), ... );
+   return table;
+}
+
+
+// ============================================================================
+//
+// NVIC enable, disable and priority of sets of IRQs
+//
+// The generator emits for each peripheral that has interrupts the
+// set of its IRQs, like USART0_IRQS. Sets can be added, and are
+// written with one register write per 32 IRQs (enable, disable):
+//
+// hr::nvic_enable< USART0_IRQS + TC0_IRQS >();
+// hr::nvic_priority< USART0_IRQS + TC0_IRQS, 3 >();
+//
+// The priority is shifted to the HARDWARE_REGISTERS_NVIC_PRIORITY_BITS
+// (default 4) implemented bits. It is written with a byte store per IRQ,
+// or with one word store when all 4 IRQs of a priority register are in 
+// the set. The priority register is never read.
+//
+// ============================================================================
+
+#ifndef HARDWARE_REGISTERS_NVIC_PRIORITY_BITS
+   #define HARDWARE_REGISTERS_NVIC_PRIORITY_BITS 4
+#endif
+
+struct irq_set {
+   register_value_type bits[ 16 ] = {};
+
+   constexpr bool contains( int irq ) const {
+      return ( ( bits[ irq / 32 ] >> ( irq % 32 ) ) & 1 ) != 0;
+   }
+};
+
+template< typename... _irqs >
+constexpr irq_set make_irq_set( _irqs... irqs ){
+   irq_set set;
+   ( ( set.bits[ static_cast< int >( irqs ) / 32 ] |= 
+      1u << ( static_cast< int >( irqs ) % 32 ) ), ... );
+   return set;
+}
+
+constexpr irq_set operator+( irq_set lhs, const irq_set & rhs ){
+   for( int word = 0; word < 16; ++word ){
+      lhs.bits[ word ] |= rhs.bits[ word ];
+   }
+   return lhs;
+}
+
+// the NVIC ISER and ICER: a bit per IRQ, a 1 acts, a 0 has no effect
+template< irq_set _irqs, uintptr_t _address, int _word = 0 >
+   __attribute__((always_inline))
+inline void nvic_write_bits(){
+   if constexpr( _word < 16 ){
+      if constexpr( _irqs.bits[ _word ] != 0 ){
+         * ( volatile register_value_type * )( _address + 4 * _word ) = 
+            _irqs.bits[ _word ];
+      }
+      nvic_write_bits< _irqs, _address, _word + 1 >();
+   }
+}
+
+template< irq_set _irqs >
+   __attribute__((always_inline))
+inline void nvic_enable(){
+   nvic_write_bits< _irqs, 0xE000E100 >();
+}
+
+template< irq_set _irqs >
+   __attribute__((always_inline))
+inline void nvic_disable(){
+   nvic_write_bits< _irqs, 0xE000E180 >();
+}
+
+// the bytes of NVIC IPR _word that belong to IRQs in the set
+template< irq_set _irqs, int _word >
+constexpr register_value_type priority_bytes(){
+   register_value_type bytes = 0;
+   for( int i = 0; i < 4; ++i ){
+      if( _irqs.contains( 4 * _word + i ) ){
+         bytes |= 0xFFu << ( 8 * i );
+      }
+   }
+   return bytes;
+}
+
+// the NVIC IPR registers are byte-accessible: a word with the priorities
+// of 4 IRQs in the set is one word store, otherwise each priority is 
+// a byte store, so the priorities of the other IRQs are not read
+template< irq_set _irqs, int _priority, int _word = 0 >
+   __attribute__((always_inline))
+inline void nvic_priority_words(){
+   if constexpr( _word < 128 ){
+      constexpr register_value_type bytes = priority_bytes< _irqs, _word >();
+      constexpr register_value_type priority = 
+         _priority << ( 8 - HARDWARE_REGISTERS_NVIC_PRIORITY_BITS );
+      constexpr uintptr_t address = 0xE000E400 + 4 * _word;
+      if constexpr( bytes == 0xFFFFFFFF ){
+         * ( volatile register_value_type * ) address = 0x01010101u * priority;
+      } else if constexpr( bytes != 0 ){
+         for( int i = 0; i < 4; ++i ){
+            if( ( bytes >> ( 8 * i ) ) & 0xFF ){
+               * ( volatile uint8_t * )( address + i ) = priority;
+            }
+         }
+      }
+      nvic_priority_words< _irqs, _priority, _word + 1 >();
+   }
+}
+
+template< irq_set _irqs, int _priority >
+   requires( 
+      _priority >= 0 
+      && _priority < ( 1 << HARDWARE_REGISTERS_NVIC_PRIORITY_BITS ) )
+   __attribute__((always_inline))
+inline void nvic_priority(){
+   nvic_priority_words< _irqs, _priority >();
+}
+
+
+// ============================================================================
+//
+// a table-driven initialization sequence
+//
+// A long initialization (clock setup, pin muxing, ...) written as
+// register operations compiles to a long series of literal loads
+// and stores. As an init_table it is a constexpr table of 3 words
+// per step, in flash, executed by one shared interpreter loop: 
+// smaller, at the cost of a few cycles per step.
+//
+// constexpr auto clock_init = hr::init_sequence(
+//    hr::init_write< &Pmc::CKGR_MOR >( 
+//       CKGR_MOR_MOSCRCEN | CKGR_MOR_MOSCXTEN | CKGR_MOR_MOSCSEL ),
+//    hr::init_wait_set< &Pmc::PMC_SR >( PMC_SR_MOSCSELS ),
+//    hr::init_update< &Pmc::PMC_MCKR >( PMC_MCKR_CSS_MAIN_CLK ),
+//    hr::init_wait_set< &Pmc::PMC_SR >( PMC_SR_MCKRDY )
+// );
+// hr::run( clock_init );
+//
+// A step names its register as a member of a peripheral struct, and
+// the base address of the peripheral. The default base is the 
+// base_address of the struct, which the generator only emits for the
+// struct of a single peripheral. A struct that is used by several 
+// peripherals (Piob is Pioa) has none, so for each of them (PIOA 
+// too) the base address must be passed:
+//
+//    hr::init_write< &Piob::PER, 0x400e1000 >( PIOB_PER_P< 27 > )
+//
+// A step is allowed when the same operation on the register is: 
+// init_write as =, init_update as <<=, init_set as |=, init_clear as 
+// &= ~, and the waits as hr::wait_until. Like those operations, a
+// step that needs no read (for instance a |= of a one-to-set register) 
+// is a plain write. The interpreter uses the default access policy,
+// so the register must use it too, and it can't protect a
+// read-modify-write, so an update needs a register that is not 
+// shared with interrupt handlers (concurrency none).
+//
+// ============================================================================
+
+enum class init_kind : register_address_type {
+   write  = 0,   // register = or_value
+   update = 1,   // register = ( register & ~ mask ) | or_value
+   wait   = 2    // wait until ( register & mask ) == or_value
+};
+
+// registers are word-aligned, so the kind is stored
+// in the lower 2 bits of the address
+struct init_step {
+   register_address_type  address_and_kind;
+   register_value_type    mask;
+   register_value_type    or_value;
+};
+
+template< int _number_of_steps >
+struct init_table {
+   init_step steps[ _number_of_steps ];
+};
+
+template< typename... _steps >
+constexpr init_table< sizeof...( _steps ) > init_sequence( 
+   _steps... steps 
+){
+   return { { steps... } };
+}
+
+constexpr init_step make_init_step( 
+   register_address_type  address, 
+   init_kind              kind,
+   register_value_type    mask,
+   register_value_type    or_value
+){
+   return { address | (register_address_type) kind, mask, or_value };
+}
+
+// the address of the register _member of the peripheral at _base
+template< auto _member, register_address_type _base >
+constexpr register_address_type init_address = 
+   _base + ( member_register< _member >::class_register_address 
+      - member_peripheral< _member >::layout_address );
+
+// the interpreter accesses the register as the register itself would
+template< auto _member >
+constexpr bool init_can_access = same_type< 
+   typename member_register< _member >::access_policy, 
+   HARDWARE_REGISTERS_ACCESS_POLICY >;
+
+// and it does a read-modify-write without protection
+template< auto _member >
+constexpr bool init_can_modify = init_can_access< _member >
+   && member_register< _member >::properties::concurrency 
+      == register_concurrency::none;
+
+// =========================================================================
+// register = value
+// =========================================================================
+
+template<
+   auto                   _member,
+   register_address_type  _base = member_peripheral< _member >::base_address,
+   register_address_type  _class_register_address, 
+   register_value_type    _used
+>
+   requires( 
+      init_can_access< _member >
+      && requires( 
+         member_register< _member > & r, 
+         field_value< _class_register_address, _used > value 
+      ){ r = value; } )
+constexpr init_step init_write( 
+   field_value< _class_register_address, _used > value
+){
+   return make_init_step( 
+      init_address< _member, _base >, init_kind::write, 0, value.value );
+}
+
+template<
+   auto                   _member,
+   register_address_type  _base = member_peripheral< _member >::base_address,
+   register_address_type  _class_register_address, 
+   register_value_type    _used,
+   register_value_type    _mask
+>
+   requires( 
+      init_can_access< _member >
+      && requires( 
+         member_register< _member > & r, 
+         field_mask< _class_register_address, _used, _mask > mask 
+      ){ r = mask; } )
+constexpr init_step init_write( 
+   field_mask< _class_register_address, _used, _mask > value
+){
+   return make_init_step( 
+      init_address< _member, _base >, init_kind::write, 0, _mask );
+}
+
+// =========================================================================
+// register <<= value
+// =========================================================================
+
+template<
+   auto                   _member,
+   register_address_type  _base = member_peripheral< _member >::base_address,
+   register_address_type  _class_register_address, 
+   register_value_type    _used
+>
+   requires( 
+      ( member_register< _member >::covers_writable( _used ) 
+         ? init_can_access< _member > : init_can_modify< _member > )
+      && requires( 
+         member_register< _member > & r, 
+         field_value< _class_register_address, _used > value 
+      ){ r <<= value; } )
+constexpr init_step init_update( 
+   field_value< _class_register_address, _used > value
+){
+   if constexpr( member_register< _member >::covers_writable( _used ) ){
+      return make_init_step( 
+         init_address< _member, _base >, init_kind::write, 0, value.value );
+   } else {
+      return make_init_step( 
+         init_address< _member, _base >, init_kind::update, _used, value.value );
+   }
+}
+
+// =========================================================================
+// register |= mask, register &= ~ mask
+// =========================================================================
+
+template<
+   auto                   _member,
+   register_address_type  _base = member_peripheral< _member >::base_address,
+   register_address_type  _class_register_address, 
+   register_value_type    _used,
+   register_value_type    _mask
+>
+   requires( 
+      ( member_register< _member >::ones_act 
+         ? init_can_access< _member > : init_can_modify< _member > )
+      && requires( 
+         member_register< _member > & r, 
+         field_mask< _class_register_address, _used, _mask > mask 
+      ){ r |= mask; } )
+constexpr init_step init_set( 
+   field_mask< _class_register_address, _used, _mask > mask
+){
+   if constexpr( member_register< _member >::ones_act ){
+      return make_init_step( 
+         init_address< _member, _base >, init_kind::write, 0, _mask );
+   } else {
+      return make_init_step( 
+         init_address< _member, _base >, init_kind::update, _mask, _mask );
+   }
+}
+
+template<
+   auto                   _member,
+   register_address_type  _base = member_peripheral< _member >::base_address,
+   register_address_type  _class_register_address, 
+   register_value_type    _used,
+   register_value_type    _mask
+>
+   requires( 
+      ( member_register< _member >::zeros_act 
+         ? init_can_access< _member > : init_can_modify< _member > )
+      && requires( 
+         member_register< _member > & r, 
+         field_mask< _class_register_address, _used, _mask > mask 
+      ){ r &= ~ mask; } )
+constexpr init_step init_clear( 
+   field_mask< _class_register_address, _used, _mask > mask
+){
+   if constexpr( member_register< _member >::zeros_act ){
+      return make_init_step( 
+         init_address< _member, _base >, init_kind::write, 0, 
+         member_register< _member >::properties::writable & ~ _mask );
+   } else {
+      return make_init_step( 
+         init_address< _member, _base >, init_kind::update, _mask, 0 );
+   }
+}
+
+// =========================================================================
+// wait until the fields have the value, 
+// or until the bits of the mask are all set or all cleared
+// =========================================================================
+
+// the register can be waited for as by hr::wait_until
+template< auto _member, register_address_type _class_register_address >
+constexpr bool init_can_wait = init_can_access< _member >
+   && member_register< _member >::class_register_address 
+      == _class_register_address
+   && member_register< _member >::can_read 
+   && ! member_register< _member >::read_has_effect;
+
+template<
+   auto                   _member,
+   register_address_type  _base = member_peripheral< _member >::base_address,
+   register_address_type  _class_register_address, 
+   register_value_type    _used
+>
+   requires init_can_wait< _member, _class_register_address >
+constexpr init_step init_wait( 
+   field_value< _class_register_address, _used > value
+){
+   return make_init_step( 
+      init_address< _member, _base >, init_kind::wait, _used, value.value );
+}
+
+template<
+   auto                   _member,
+   register_address_type  _base = member_peripheral< _member >::base_address,
+   register_address_type  _class_register_address, 
+   register_value_type    _used,
+   register_value_type    _mask
+>
+   requires init_can_wait< _member, _class_register_address >
+constexpr init_step init_wait_set( 
+   field_mask< _class_register_address, _used, _mask > mask
+){
+   return make_init_step( 
+      init_address< _member, _base >, init_kind::wait, _mask, _mask );
+}
+
+template<
+   auto                   _member,
+   register_address_type  _base = member_peripheral< _member >::base_address,
+   register_address_type  _class_register_address, 
+   register_value_type    _used,
+   register_value_type    _mask
+>
+   requires init_can_wait< _member, _class_register_address >
+constexpr init_step init_wait_clear( 
+   field_mask< _class_register_address, _used, _mask > mask
+){
+   return make_init_step( 
+      init_address< _member, _base >, init_kind::wait, _mask, 0 );
+}
+
+// =========================================================================
+// the interpreter: one copy, shared by all tables
+// =========================================================================
+
+   __attribute__((noinline))
+inline void run_init_steps( 
+   const init_step * step, 
+   int number_of_steps 
+){
+   using access = HARDWARE_REGISTERS_ACCESS_POLICY;
+   for( ; number_of_steps > 0; --number_of_steps, ++step ){
+      volatile register_value_type & the_register = 
+         * ( volatile register_value_type * ) 
+            (uintptr_t)( step->address_and_kind & ~ 0b11 );
+      switch( (init_kind)( step->address_and_kind & 0b11 ) ){
+         case init_kind::write:
+            access::store( the_register, step->or_value );
+            break;
+         case init_kind::update:
+            access::store( the_register, 
+               ( access::load( the_register ) & ~ step->mask ) | step->or_value );
+            break;
+         case init_kind::wait:
+            while( ( access::load( the_register ) & step->mask ) != step->or_value ){}
+            break;
+      }
+   }
+}
+
+template< int _number_of_steps >
+   __attribute__((always_inline))
+inline void run( const init_table< _number_of_steps > & table ){
+   run_init_steps( table.steps, _number_of_steps );
+}
+
+   
+// ============================================================================
+// end of namespace hardware_registers
+// ============================================================================
+
+};
 
+#endif // HARDWARE_REGISTERS_HPP
@@ -10,31 +10,21 @@ int main(){
       /* Switch to 3-20MHz Xtal oscillator */
   PMC->CKGR_MOR = /* CKGR_MOR_KEY_PASSWD | */ /* SYS_BOARD_OSCOUNT | */ CKGR_MOR_MOSCRCEN | CKGR_MOR_MOSCXTEN | CKGR_MOR_MOSCSEL;
 
-  while ( !(PMC->PMC_SR & PMC_SR_MOSCSELS) )
-  {
-  }
+  hr::wait_until( PMC->PMC_SR, PMC_SR_MOSCSELS );
  	PMC->PMC_MCKR = (PMC->PMC_MCKR & ~PMC_MCKR_CSS_Msk) | PMC_MCKR_CSS_MAIN_CLK;
-  while (!(PMC->PMC_SR & PMC_SR_MCKRDY))
-  {
-  }
+  hr::wait_until( PMC->PMC_SR, PMC_SR_MCKRDY );
 
   /* Initialize PLLA */
   // PMC->CKGR_PLLAR = SYS_BOARD_PLLAR;
-  while ( !(PMC->PMC_SR & PMC_SR_LOCKA) )
-  {
-  }
+  hr::wait_until( PMC->PMC_SR, PMC_SR_LOCKA );
 
   /* Switch to main clock */
   PMC->PMC_MCKR = ( PMC->PMC_MCKR & ~PMC_MCKR_CSS_Msk) | PMC_MCKR_CSS_MAIN_CLK;
-  while ( !(PMC->PMC_SR & PMC_SR_MCKRDY) )
-  {
-  }
+  hr::wait_until( PMC->PMC_SR, PMC_SR_MCKRDY );
 
   /* Switch to PLLA */
   PMC->PMC_MCKR = (uint32_t ) 12; // SYS_BOARD_MCKR;
-  while ( !(PMC->PMC_SR & PMC_SR_MCKRDY) )
-  {
-  }
+  hr::wait_until( PMC->PMC_SR, PMC_SR_MCKRDY );
   
   /* Determine clock frequency according to clock register values */
   switch ( PMC->PMC_MCKR & PMC_MCKR_CSS_Msk )